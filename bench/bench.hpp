@@ -0,0 +1,28 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+// Milliseconds since start
+inline double get_elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Nearest-rank percentile. samples must be sorted and nonempty
+inline double get_percentile(const std::vector<double>& samples, double percentile) {
+    size_t rank = std::max<size_t>((percentile / 100.) * samples.size() + .5, 1);
+    return samples[std::min(rank, samples.size()) - 1];
+}
+
+inline void print_latencies(const char* name, std::vector<double> samples) {
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    printf("%-32s p50 %9.3f ms  p90 %9.3f ms  p99 %9.3f ms  (n = %zu)\n",
+        name,
+        get_percentile(samples, 50.),
+        get_percentile(samples, 90.),
+        get_percentile(samples, 99.),
+        samples.size());
+}
@@ -0,0 +1,128 @@
+// Times get_tenebra_pids() against synthetic procfs trees, so that changes to
+// process discovery in util.cpp can be judged by numbers. Build with
+// `make -C bench` and run
+//
+//     bench/discovery_bench [ITERATIONS] [PROCESS_COUNT...]
+//
+// which defaults to 50 iterations at 1k, 10k and 50k processes. Read syscalls
+// per lookup are taken from /proc/self/io. For every syscall, run it under
+// strace, which prints a summary on exit:
+//
+//     strace -c -f bench/discovery_bench 20 10000
+
+#include "../util.hpp"
+#include "bench.hpp"
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static const unsigned long long tenebra_start_time = 123456;
+
+static void write_file(const std::filesystem::path& path, const std::string& contents) {
+    std::ofstream(path) << contents;
+}
+
+// One directory per process with the files discovery reads: stat, status, comm
+// and environ. Tenebra gets the highest PID
+static void create_proc_root(const std::filesystem::path& proc_root, pid_t process_count) {
+    static const char* comms[] = {"bash", "systemd", "kworker/0:1", "Xwayland", "pipewire"};
+    for (pid_t pid = 2; pid < process_count + 2; ++pid) {
+        bool is_tenebra = pid == process_count + 1;
+        const char* comm = is_tenebra ? "tenebra" : comms[pid % std::size(comms)];
+        unsigned long long start_time = is_tenebra ? tenebra_start_time : pid;
+
+        std::filesystem::path path = proc_root / std::to_string(pid);
+        std::filesystem::create_directory(path);
+        write_file(path / "stat", std::to_string(pid) + " (" + comm + ") S 1 " + std::to_string(pid) + ' ' + std::to_string(pid) + " 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 " + std::to_string(start_time) + " 0 0 0\n");
+        write_file(path / "status", std::string("Name:\t") + comm + "\nState:\tS (sleeping)\nUid:\t" + std::to_string(getuid()) + '\t' + std::to_string(getuid()) + '\n');
+        write_file(path / "comm", std::string(comm) + '\n');
+        write_file(path / "environ", {});
+    }
+}
+
+static unsigned long long get_read_syscalls(int io_fd) {
+    char buf[512];
+    ssize_t size = pread(io_fd, buf, sizeof buf - 1, 0);
+    if (size <= 0) return 0;
+    buf[size] = '\0';
+    const char* syscr = strstr(buf, "syscr: ");
+    return syscr ? strtoull(syscr + 7, nullptr, 10) : 0;
+}
+
+// prepare runs before each lookup, outside the timing
+template <typename F>
+static void run(const char* name, int iterations, int io_fd, F prepare) {
+    // Reading the counter costs a read syscall of its own
+    unsigned long long overhead = get_read_syscalls(io_fd);
+    overhead = get_read_syscalls(io_fd) - overhead;
+
+    std::vector<double> latencies;
+    unsigned long long read_syscalls = 0;
+    pid_t pid = -1;
+    for (int i = 0; i < iterations; ++i) {
+        prepare();
+        unsigned long long reads = get_read_syscalls(io_fd);
+        auto start = std::chrono::steady_clock::now();
+        pid = get_tenebra_pids({{}})[0];
+        latencies.push_back(get_elapsed_ms(start));
+        read_syscalls += get_read_syscalls(io_fd) - reads - overhead;
+    }
+    print_latencies(name, std::move(latencies));
+    printf("%-32s %.1f read syscalls per lookup, found PID %d\n", "", (double) read_syscalls / iterations, pid);
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 50;
+    std::vector<pid_t> process_counts;
+    for (int i = 2; i < argc; ++i) {
+        process_counts.push_back(atoi(argv[i]));
+    }
+    if (process_counts.empty()) process_counts = {1000, 10000, 50000};
+    if (iterations < 1) {
+        fputs("Usage: discovery_bench [ITERATIONS] [PROCESS_COUNT...]\n", stderr);
+        return EXIT_FAILURE;
+    }
+
+    char temp_template[] = "/tmp/discovery_bench.XXXXXX";
+    if (!mkdtemp(temp_template)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    std::filesystem::path temp_path = temp_template;
+    setenv("XDG_CONFIG_HOME", (temp_path / "config").c_str(), 1);
+    std::filesystem::create_directories(get_config_path());
+    std::filesystem::path pidfile_path = get_config_path() / "tenebra.pid";
+
+    int io_fd = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+    for (pid_t process_count : process_counts) {
+        std::filesystem::path proc_root = temp_path / ("proc" + std::to_string(process_count));
+        std::filesystem::create_directory(proc_root);
+        create_proc_root(proc_root, process_count);
+        set_proc_root(proc_root);
+        printf("%d processes:\n", process_count);
+
+        // The first lookup after Tenebra starts elsewhere, which also writes the pidfile
+        run("  running, no pidfile", iterations, io_fd, [&pidfile_path]() {
+            std::filesystem::remove(pidfile_path);
+        });
+        // Every lookup after that
+        run("  running, valid pidfile", iterations, io_fd, []() {});
+
+        // Stopped, so the pidfile is stale and every process has to be ruled out
+        std::filesystem::remove_all(proc_root / std::to_string(process_count + 1));
+        run("  stopped", iterations, io_fd, []() {});
+
+        std::filesystem::remove_all(proc_root);
+    }
+
+    if (io_fd != -1) close(io_fd);
+    std::filesystem::remove_all(temp_path);
+    return EXIT_SUCCESS;
+}
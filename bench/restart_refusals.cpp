@@ -0,0 +1,150 @@
+// Counts the connections refused while a server restarts, first with a plain
+// restart and then with the listening socket held by this process and passed to
+// each new server the way socket activation passes it to Tenebra. The server is
+// this program run with --serve, which takes STARTUP_MS to start, like Tenebra
+// loading its certificates, then accepts and closes connections until killed.
+// Build with `make -C bench` and run
+//
+//     bench/restart_refusals [RESTARTS] [STARTUP_MS]
+//
+// which defaults to 5 restarts of a server that takes 300 ms to start. A client
+// connects over loopback every 200 us throughout
+
+#include "../spawn.hpp"
+#include "../util.hpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+struct ConnectCounts {
+    std::atomic<unsigned long> connected = 0;
+    std::atomic<unsigned long> refused = 0;
+    std::atomic<unsigned long> failed = 0; // For any other reason
+};
+
+static int serve(int startup_ms, unsigned short port) {
+    usleep(startup_ms * 1000);
+
+    int fd;
+    const char* listen_fds = getenv("LISTEN_FDS");
+    const char* listen_pid = getenv("LISTEN_PID");
+    if (listen_fds && listen_pid && atoi(listen_fds) == 1 && atoi(listen_pid) == getpid()) {
+        fd = 3;
+    } else if ((fd = open_listen_socket(port)) == -1) {
+        perror("open_listen_socket");
+        return EXIT_FAILURE;
+    }
+
+    for (;;) {
+        int connection;
+        if ((connection = accept(fd, nullptr, nullptr)) != -1) {
+            close(connection);
+        }
+    }
+}
+
+static void run_client(unsigned short port, const std::atomic<bool>& running, ConnectCounts& counts) {
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr = {htonl(INADDR_LOOPBACK)}};
+    while (running) {
+        int fd;
+        if ((fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
+            ++counts.failed;
+        } else if (connect(fd, (struct sockaddr*) &addr, sizeof addr) == -1) {
+            ++(errno == ECONNREFUSED ? counts.refused : counts.failed);
+        } else {
+            ++counts.connected;
+        }
+        if (fd != -1) close(fd);
+        usleep(200);
+    }
+}
+
+static pid_t start_server(const std::string& exe_path, int startup_ms, unsigned short port, int listen_fd) {
+    std::string startup_ms_str = std::to_string(startup_ms);
+    std::string port_str = std::to_string(port);
+    char* const argv[] = {(char*) exe_path.c_str(), (char*) "--serve", startup_ms_str.data(), port_str.data(), nullptr};
+    pid_t pid;
+    if ((pid = spawn(exe_path.c_str(), argv, {.listen_fd = listen_fd})) == -1) {
+        perror("spawn");
+        exit(EXIT_FAILURE);
+    }
+    return pid;
+}
+
+static void stop_server(pid_t pid) {
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+}
+
+// listen_fd is held across restarts if it isn't -1
+static void run(const char* name, const std::string& exe_path, int restarts, int startup_ms, unsigned short port, int listen_fd) {
+    pid_t pid = start_server(exe_path, startup_ms, port, listen_fd);
+    usleep((startup_ms + 100) * 1000);
+
+    std::atomic<bool> running = true;
+    ConnectCounts counts;
+    std::thread client(run_client, port, std::cref(running), std::ref(counts));
+    for (int i = 0; i < restarts; ++i) {
+        usleep(100000);
+        stop_server(pid);
+        pid = start_server(exe_path, startup_ms, port, listen_fd);
+        usleep((startup_ms + 100) * 1000); // Long enough for anything queued to be accepted
+    }
+    running = false;
+    client.join();
+    stop_server(pid);
+
+    printf("%-24s %lu refused (%.1f per restart), %lu connected, %lu failed otherwise\n",
+        name,
+        counts.refused.load(),
+        (double) counts.refused / restarts,
+        counts.connected.load(),
+        counts.failed.load());
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && !strcmp(argv[1], "--serve")) {
+        return serve(atoi(argv[2]), atoi(argv[3]));
+    }
+
+    int restarts = argc > 1 ? atoi(argv[1]) : 5;
+    int startup_ms = argc > 2 ? atoi(argv[2]) : 300;
+    if (restarts < 1 || startup_ms < 0) {
+        fputs("Usage: restart_refusals [RESTARTS] [STARTUP_MS]\n", stderr);
+        return EXIT_FAILURE;
+    }
+
+    char exe_path[4096];
+    ssize_t size;
+    if ((size = readlink("/proc/self/exe", exe_path, sizeof exe_path - 1)) == -1) {
+        perror("readlink");
+        return EXIT_FAILURE;
+    }
+    exe_path[size] = '\0';
+
+    // The held socket is bound first, which also picks a free port for both runs
+    int listen_fd;
+    if ((listen_fd = open_listen_socket(0)) == -1) {
+        perror("open_listen_socket");
+        return EXIT_FAILURE;
+    }
+    struct sockaddr_storage addr;
+    socklen_t addr_size = sizeof addr;
+    getsockname(listen_fd, (struct sockaddr*) &addr, &addr_size);
+    unsigned short port = ntohs(addr.ss_family == AF_INET6 ? ((struct sockaddr_in6*) &addr)->sin6_port : ((struct sockaddr_in*) &addr)->sin_port);
+
+    run("held socket", exe_path, restarts, startup_ms, port, listen_fd);
+    close(listen_fd);
+    run("plain restart", exe_path, restarts, startup_ms, port, -1);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+// Compares launch latency between spawn() and the fork() and exec path it
+// replaced, both measured until exec has succeeded. fork() copies the parent's
+// page tables, so the parent maps and touches some memory first to stand in for
+// the GUI's. Build with `make -C bench` and run
+//
+//     bench/spawn_bench [ITERATIONS] [MAPPED_MIB...]
+//
+// which defaults to 200 launches of true with 0 and 512 MiB mapped
+
+#include "../spawn.hpp"
+#include "bench.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// How Tenebra was launched before spawn(), down to reporting exec errors over a
+// close-on-exec pipe
+static pid_t fork_exec(const char* file, char* const argv[]) {
+    int error_pipe[2];
+    if (pipe2(error_pipe, O_CLOEXEC) == -1) return -1;
+
+    pid_t pid;
+    if ((pid = fork()) == -1) {
+        close(error_pipe[0]);
+        close(error_pipe[1]);
+        return -1;
+    } else if (pid == 0) {
+        close(error_pipe[0]);
+        execvp(file, argv);
+        int error = errno;
+        write(error_pipe[1], &error, sizeof(int));
+        _exit(127);
+    }
+
+    close(error_pipe[1]);
+    int error;
+    ssize_t size = read(error_pipe[0], &error, sizeof(int));
+    close(error_pipe[0]);
+    if (size == sizeof(int)) {
+        waitpid(pid, nullptr, 0);
+        errno = error;
+        return -1;
+    }
+    return pid;
+}
+
+template <typename F>
+static void run(const std::string& name, int iterations, F launch) {
+    char* const argv[] = {(char*) "true", nullptr};
+    std::vector<double> latencies;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        pid_t pid = launch("true", argv);
+        latencies.push_back(get_elapsed_ms(start));
+        if (pid == -1) {
+            fprintf(stderr, "%s: Launch failed: %s\n", name.c_str(), strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        waitpid(pid, nullptr, 0);
+    }
+    print_latencies(name.c_str(), std::move(latencies));
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    std::vector<size_t> mapped_mibs;
+    for (int i = 2; i < argc; ++i) {
+        mapped_mibs.push_back(atoi(argv[i]));
+    }
+    if (mapped_mibs.empty()) mapped_mibs = {0, 512};
+    if (iterations < 1) {
+        fputs("Usage: spawn_bench [ITERATIONS] [MAPPED_MIB...]\n", stderr);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t mapped_mib : mapped_mibs) {
+        void* mapping = nullptr;
+        size_t size = mapped_mib << 20;
+        if (size) {
+            if ((mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+                perror("mmap");
+                return EXIT_FAILURE;
+            }
+            memset(mapping, 1, size); // Otherwise there would be no page tables to copy
+        }
+
+        std::string suffix = " (" + std::to_string(mapped_mib) + " MiB mapped)";
+        run("spawn()" + suffix, iterations, [](const char* file, char* const argv[]) {
+            return spawn(file, argv);
+        });
+        run("fork() and exec" + suffix, iterations, fork_exec);
+
+        if (mapping) munmap(mapping, size);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,294 @@
+#include "cli.hpp"
+#include "json.hpp"
+#include "settings.hpp"
+#include "spawn.hpp"
+#include "toml.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#ifndef _WIN32
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using nlohmann::json;
+
+static int fail(const std::string& instance, const std::string& error) {
+    puts(json({{"ok", false}, {"instance", instance}, {"error", error}}).dump().c_str());
+    return EXIT_FAILURE;
+}
+
+static json get_status(const std::string& instance) {
+    pid_t pid = get_tenebra_pid(instance);
+    json ret = {
+        {"ok", true},
+        {"instance", instance},
+        {"running", pid != -1},
+        {"pid", pid != -1 ? json(pid) : json(nullptr)},
+    };
+    try {
+        auto settings = parse_settings(toml::parse(get_config_path(instance) / "config.toml"));
+        ret["port"] = std::get<long long>(settings[setting_index("port")]);
+    } catch (...) {
+        ret["port"] = nullptr;
+    }
+    return ret;
+}
+
+// Starts Tenebra the way MainWindow::launch() does, minus the parts that need a
+// window to outlive the launch: output capture, readiness probing, supervision and
+// socket activation. Output goes to the log file if save_log is set
+static int start(const std::string& instance, json& status) {
+    auto config_path = get_config_path(instance);
+    Settings settings = get_default_settings();
+    if (std::error_code ec; std::filesystem::exists(config_path / "config.toml", ec)) {
+        try {
+            settings = parse_settings(toml::parse(config_path / "config.toml"));
+        } catch (...) {
+            return fail(instance, "Failed to parse settings at " + (config_path / "config.toml").string());
+        }
+    }
+
+#ifdef _WIN32
+    if (std::string error; start_tenebra_service(error) == -1) {
+        return fail(instance, "Failed to start Tenebra (" + error + ')');
+    }
+    status["running"] = true; // The service reports its PID asynchronously
+#else
+    TenebraSpawnOptions spawn_options;
+    if (get_tenebra_spawn_options(settings, instance, spawn_options) == -1) {
+        return fail(instance, "Failed to start Tenebra (invalid CPU set \"" + std::get<std::string>(settings[setting_index("cpu_affinity")]) + "\")");
+    }
+    SpawnOptions& options = spawn_options.options;
+
+    if ((options.stdin_fd = open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1) {
+        return fail(instance, "Failed to start Tenebra (open failed, error " + std::to_string(errno) + ')');
+    }
+    if (std::get<bool>(settings[setting_index("save_log")])) {
+        options.stdout_fd = open((config_path / "tenebra.log").c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    } else {
+        options.stdout_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    }
+    if (options.stdout_fd == -1) {
+        int error = errno;
+        close(options.stdin_fd);
+        return fail(instance, "Failed to start Tenebra (open failed, error " + std::to_string(error) + ')');
+    }
+    options.stderr_fd = options.stdout_fd;
+
+    char* const argv[] = {(char*) "tenebra", nullptr};
+    pid_t pid = spawn("tenebra", argv, options);
+    int error = errno;
+    close(options.stdin_fd);
+    close(options.stdout_fd);
+    if (pid == -1) {
+        return fail(instance, "Failed to start Tenebra (error " + std::to_string(error) + ')');
+    }
+
+    // Not reaped here. Once this process exits, Tenebra is reparented to init
+    set_tenebra_pidfile(pid, instance);
+    status["running"] = true;
+    status["pid"] = pid;
+    #ifdef __linux__
+    status["refused"] = get_refused_spawn_options(pid, options);
+    #endif
+#endif
+    return EXIT_SUCCESS;
+}
+
+// Stops Tenebra the way MainWindow::stop() does, but blocks until it's gone
+static int stop(const std::string& instance, json& status) {
+    pid_t pid = get_tenebra_pid(instance);
+    if (pid == -1) return EXIT_SUCCESS;
+
+    auto stop_time = std::chrono::steady_clock::now();
+    bool killed = false;
+#ifdef _WIN32
+    if (std::string error; terminate_tenebra_process(pid, error) == -1) {
+        return fail(instance, "Failed to stop Tenebra (" + error + ')');
+    }
+#else
+    Settings settings = get_default_settings();
+    try {
+        settings = parse_settings(toml::parse(get_config_path(instance) / "config.toml"));
+    } catch (...) {}
+    auto shutdown_grace_period = std::get<long long>(settings[setting_index("shutdown_grace_period")]);
+
+    int pidfd;
+    if (int result = terminate_tenebra(pid, instance, pidfd); result == -1) {
+        return fail(instance, "Failed to stop Tenebra (kill failed, error " + std::to_string(errno) + ')');
+    } else if (result == 0) {
+        if (!wait_for_exit(pid, pidfd, shutdown_grace_period * 1000)) {
+            kill_tenebra(pid, pidfd);
+            killed = true;
+            wait_for_exit(pid, pidfd, 5000);
+        }
+        if (pidfd != -1) close(pidfd);
+    }
+#endif
+
+    status["running"] = false;
+    status["pid"] = nullptr;
+    status["stopped_in_ms"] = (long) std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stop_time).count();
+    status["killed"] = killed;
+    return EXIT_SUCCESS;
+}
+
+static int set(const std::string& instance, int argc, char* argv[], json& status) {
+    if (!argc) {
+        return fail(instance, "Usage: set KEY=VALUE...");
+    }
+
+    auto config_path = get_config_path(instance);
+    if (config_path.empty()) {
+        return fail(instance, "Failed to find the settings directory");
+    }
+
+    toml::value config = toml::table();
+    if (std::filesystem::exists(config_path / "config.toml")) {
+        try {
+            config = toml::parse(config_path / "config.toml");
+        } catch (...) {
+            return fail(instance, "Failed to parse settings at " + (config_path / "config.toml").string());
+        }
+    }
+
+    json changed = json::object();
+    bool modified = false; // Whether any value differs from the file's
+    for (int i = 0; i < argc; ++i) {
+        const char* equals = strchr(argv[i], '=');
+        if (!equals) {
+            return fail(instance, std::string("Expected KEY=VALUE, got \"") + argv[i] + '"');
+        }
+        std::string key(argv[i], equals - argv[i]);
+        std::string value(equals + 1);
+
+        // The GUI would ignore any other key, or fail to parse a value of another type
+        size_t index = get_setting_index(key);
+        if (index == setting_count) {
+            return fail(instance, "Unknown setting " + key);
+        }
+        const SettingSchema& setting = setting_schema[index];
+        toml::value old_value = config.contains(key) ? config.at(key) : toml::value();
+
+        switch (setting.get_type()) {
+        case SettingType::Boolean:
+            if (value != "true" && value != "false") {
+                return fail(instance, key + " must be true or false");
+            }
+            config[key] = value == "true";
+            changed[key] = value == "true";
+            break;
+
+        case SettingType::Integer: {
+            char* end;
+            errno = 0;
+            long long integer = strtoll(value.c_str(), &end, 10);
+            if (value.empty() || *end || errno) {
+                return fail(instance, key + " must be an integer");
+            } else if (integer < setting.min || integer > setting.max) {
+                return fail(instance, key + " must be between " + std::to_string(setting.min) + " and " + std::to_string(setting.max));
+            }
+            config[key] = integer;
+            changed[key] = integer;
+            break;
+        }
+
+        case SettingType::String:
+            if (!setting.choices.empty()) {
+                std::string accepted;
+                for (const SettingChoice& choice : setting.choices) {
+                    if (value == choice.value) {
+                        accepted.clear();
+                        break;
+                    }
+                    accepted += (accepted.empty() ? "" : ", ") + std::string(choice.value);
+                }
+                if (!accepted.empty()) {
+                    return fail(instance, key + " must be one of " + accepted);
+                }
+            }
+            config[key] = value;
+            changed[key] = value;
+            break;
+        }
+        modified |= config.at(key) != old_value;
+    }
+
+    // Like the GUI's saves, an unchanged file isn't rewritten, so that nothing
+    // watching it reloads for no reason
+    if (modified) {
+        std::error_code ec;
+        std::filesystem::create_directories(config_path, ec);
+        std::ostringstream contents;
+        contents << config;
+        if (write_file_atomically(config_path / "config.toml", contents.str()) == -1) {
+            return fail(instance, "Failed to save settings to " + (config_path / "config.toml").string());
+        }
+    }
+    status["changed"] = std::move(changed);
+    return EXIT_SUCCESS;
+}
+
+int run_command(int argc, char* argv[]) {
+    int i = 1;
+    std::string instance;
+    bool has_instance = false;
+    if (i < argc && !strncmp(argv[i], "--instance=", 11)) {
+        instance = argv[i++] + 11;
+        has_instance = true;
+    } else if (i + 1 < argc && !strcmp(argv[i], "--instance")) {
+        instance = argv[i + 1];
+        i += 2;
+        has_instance = true;
+    }
+
+    static const char* commands[] = {"status", "start", "stop", "restart", "set"};
+    if (i >= argc || std::find_if(std::begin(commands), std::end(commands), [argv, i](const char* command) {
+            return !strcmp(argv[i], command);
+        }) == std::end(commands)) {
+        if (!has_instance) return -1;
+        return fail(instance, i < argc ? std::string("Unknown command ") + argv[i] : "Expected a command");
+    } else if (!instance.empty() && !is_valid_instance_name(instance)) {
+        return fail(instance, "Invalid instance name " + instance);
+    }
+#ifndef __linux__
+    // Only Linux points Tenebra at another instance's settings, or tells the
+    // processes apart
+    if (!instance.empty()) {
+        return fail(instance, "Named instances are only supported on Linux");
+    }
+#endif
+
+    std::string command = argv[i++];
+    int ret = EXIT_SUCCESS;
+    json status;
+    if (command == "set") {
+        status = {{"ok", true}, {"instance", instance}};
+        ret = set(instance, argc - i, argv + i, status);
+    } else {
+        status = get_status(instance);
+        if (command == "start") {
+            if (!status["running"].get<bool>()) ret = start(instance, status);
+        } else if (command == "stop") {
+            ret = stop(instance, status);
+        } else if (command == "restart") {
+            if ((ret = stop(instance, status)) == EXIT_SUCCESS) {
+                ret = start(instance, status);
+            }
+        }
+    }
+
+    // Failures have already printed their own status
+    if (ret == EXIT_SUCCESS) {
+        puts(status.dump().c_str());
+    }
+    return ret;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Headless subcommands for scripts and sessions without a display:
+//
+//     tenebra-gtk [--instance NAME] status|start|stop|restart
+//     tenebra-gtk [--instance NAME] set KEY=VALUE...
+//
+// Named instances are Linux-only. Each prints one JSON object to stdout. Returns the exit code, or -1 if argv
+// doesn't name a subcommand, in which case the GUI should start as usual
+int run_command(int argc, char* argv[]);
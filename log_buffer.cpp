@@ -0,0 +1,63 @@
+#include "log_buffer.hpp"
+#include <algorithm>
+#include <system_error>
+
+void LogBuffer::append_line(std::string_view line) {
+    line = line.substr(0, max_line_size);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+    if (lines.size() < capacity) {
+        lines.emplace_back(line);
+    } else {
+        lines[head].assign(line); // Reuses the evicted line's allocation
+        head = (head + 1) % capacity;
+    }
+    ++total;
+
+    if (spill_file.is_open()) {
+        spill_file << line << '\n';
+        if ((spill_size += line.size() + 1) >= max_spill_size) {
+            spill_file.close();
+            std::error_code ec;
+            std::filesystem::rename(spill_path, spill_path.string() + ".1", ec);
+            spill_file.open(spill_path, std::ios::trunc);
+            spill_size = 0;
+        }
+    }
+}
+
+void LogBuffer::append(std::string& partial, std::string_view data, bool flush) {
+    for (size_t newline; (newline = data.find('\n')) != std::string_view::npos; data.remove_prefix(newline + 1)) {
+        if (partial.empty()) {
+            append_line(data.substr(0, newline));
+        } else {
+            partial.append(data, 0, std::min(newline, max_line_size - std::min(partial.size(), max_line_size)));
+            append_line(partial);
+            partial.clear();
+        }
+    }
+
+    if (partial.size() < max_line_size) {
+        partial.append(data, 0, max_line_size - partial.size());
+    }
+    if (flush && !partial.empty()) {
+        append_line(partial);
+        partial.clear();
+    }
+}
+
+void LogBuffer::set_spill_file(std::filesystem::path path, size_t max_size) {
+    if (path == spill_path && spill_file.is_open() == !path.empty()) {
+        max_spill_size = max_size;
+        return;
+    }
+
+    spill_file.close();
+    spill_path = std::move(path);
+    max_spill_size = max_size;
+    if (!spill_path.empty()) {
+        spill_file.open(spill_path, std::ios::app);
+        std::error_code ec;
+        spill_size = std::filesystem::exists(spill_path, ec) ? std::filesystem::file_size(spill_path, ec) : 0;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Keeps the most recent lines of a process's output in a fixed-size ring, so
+// memory stays bounded however fast the process logs. Lines can also be copied
+// to a file that's rotated once it reaches a size limit
+class LogBuffer {
+protected:
+    std::vector<std::string> lines;
+    size_t capacity;
+    size_t head = 0;  // Index of the oldest line once the ring is full
+    size_t total = 0; // Lines ever appended
+
+    std::filesystem::path spill_path;
+    std::ofstream spill_file;
+    size_t spill_size = 0;
+    size_t max_spill_size = 0;
+
+    void append_line(std::string_view line);
+
+public:
+    // Longer lines are truncated
+    static constexpr size_t max_line_size = 4096;
+
+    LogBuffer(size_t capacity = 10000):
+        capacity(capacity) {
+        lines.reserve(capacity);
+    }
+
+    // Splits data into lines. partial carries an unterminated last line over to the
+    // next call for the same stream, and is flushed as a line by passing empty data
+    // with flush set
+    void append(std::string& partial, std::string_view data, bool flush = false);
+
+    size_t size() const {
+        return lines.size();
+    }
+
+    // 0 is the oldest line still held
+    const std::string& operator[](size_t i) const {
+        return lines[(head + i) % lines.size()];
+    }
+
+    size_t get_total() const {
+        return total;
+    }
+
+    // Copies every appended line to path, which is moved to path.1 whenever it grows
+    // past max_size. An empty path stops copying
+    void set_spill_file(std::filesystem::path path, size_t max_size = 1 << 20);
+};
@@ -1,17 +1,34 @@
 #include "Polyweb/polyweb.hpp"
+#include "cli.hpp"
 #include "glib.hpp"
 #include "json.hpp"
+#include "log_buffer.hpp"
+#include "metrics.hpp"
+#include "monitor.hpp"
+#include "settings.hpp"
+#include "sparkline.hpp"
+#include "spawn.hpp"
 #include "toml.hpp"
 #include "util.hpp"
 #include <adwaita.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
 #include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <gtk/gtk.h>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #ifdef _WIN32
     #include <ios>
     #include <shellapi.h>
@@ -19,14 +36,25 @@
     #include <windows.h>
 #else
     #include <errno.h>
+    #include <glib-unix.h>
     #include <signal.h>
     #include <sys/wait.h>
-    #include <thread>
     #include <unistd.h>
+    #ifdef __linux__
+        #include <sched.h>
+    #endif
 #endif
 
 using nlohmann::json;
 
+// Static initialization runs just before main(), so this is as close to the start
+// of the process as it can observe. Startup is measured from here
+static const auto process_start_time = std::chrono::steady_clock::now();
+
+static double get_time_since_process_start() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - process_start_time).count();
+}
+
 class MainWindow {
 protected:
     // All null until handle_activate builds them, so that a signal handler firing
@@ -36,35 +64,191 @@ protected:
 
     GtkWidget* button_stack = nullptr;
     GtkWidget* start_button = nullptr;
+    GtkWidget* starting_button = nullptr;
     GtkWidget* running_box = nullptr;
+    GtkWidget* stop_button = nullptr;
     GtkWidget* save_button = nullptr;
+    GtkWidget* refresh_button = nullptr;
     GtkWidget* share_button = nullptr;
-
-    GtkWidget* password_entry = nullptr;
-    GtkWidget* port_entry = nullptr;
-    GtkWidget* target_bitrate_entry = nullptr;
-    GtkWidget* windows_monitor_index_entry = nullptr;
-    GtkWidget* windows_capture_api_combo_box = nullptr;
-    GtkWidget* windows_quality_vs_speed_row = nullptr;
-    GtkWidget* windows_quality_vs_speed_scale = nullptr;
-    GtkWidget* startx_entry = nullptr;
-    GtkWidget* starty_entry = nullptr;
-    GtkWidget* endx_entry = nullptr;
-    GtkWidget* endx_check_button = nullptr;
-    GtkWidget* endy_entry = nullptr;
-    GtkWidget* endy_check_button = nullptr;
-    GtkWidget* vbv_buf_capacity_entry = nullptr;
-    GtkWidget* tcp_upnp_switch = nullptr;
-    GtkWidget* sound_forwarding_switch = nullptr;
-    GtkWidget* hwencode_switch = nullptr;
-    GtkWidget* vapostproc_switch = nullptr;
-    GtkWidget* color_downsampling_switch = nullptr;
-    GtkWidget* bwe_switch = nullptr;
-    GtkWidget* cert_entry = nullptr;
-    GtkWidget* key_entry = nullptr;
+    GtkWidget* profile_button = nullptr;
+    GMenu* profile_menu = nullptr; // The section listing the profiles
+
+    // Exported over D-Bus along with the rest of the application's actions. None are
+    // added to the application until the settings have loaded
+    GSimpleAction* save_action = nullptr;
+    GSimpleAction* refresh_action = nullptr;
+    GSimpleAction* start_action = nullptr;
+    GSimpleAction* stop_action = nullptr;
+    GSimpleAction* restart_action = nullptr;
+    GSimpleAction* share_action = nullptr;
+    GSimpleAction* profile_action = nullptr;
+    GSimpleAction* save_profile_action = nullptr;
+
+    // Indexed like setting_schema, from which they're built. A setting's widget is
+    // its row, except for sliders, and optional settings get a check button too.
+    // The Screen Capture and Security groups are rarely visited, so their rows are
+    // only built once the first frame is up
+    std::array<AdwPreferencesGroup*, setting_group_count> setting_groups = {};
+    std::array<GtkWidget*, setting_count> setting_rows = {};
+    std::array<GtkWidget*, setting_count> setting_widgets = {};
+    std::array<GtkWidget*, setting_count> setting_check_buttons = {};
+    // Names for the widgets that are used outside of the generic code
+    GtkWidget*& password_entry = setting_widgets[setting_index("password")];
+    GtkWidget*& port_entry = setting_widgets[setting_index("port")];
+    GtkWidget*& windows_monitor_index_entry = setting_widgets[setting_index("windows_monitor_index")];
+    GtkWidget*& windows_capture_api_combo_box = setting_widgets[setting_index("windows_capture_api")];
+    GtkWidget*& windows_quality_vs_speed_row = setting_rows[setting_index("windows_quality_vs_speed")];
+    GtkWidget*& vbv_buf_capacity_entry = setting_widgets[setting_index("vbv_buf_capacity")];
+    GtkWidget*& sound_forwarding_switch = setting_widgets[setting_index("sound_forwarding")];
+    GtkWidget*& hwencode_switch = setting_widgets[setting_index("hwencode")];
+    GtkWidget*& vapostproc_switch = setting_widgets[setting_index("vapostproc")];
+    GtkWidget*& color_downsampling_switch = setting_widgets[setting_index("full_chroma")];
+    GtkWidget*& bwe_switch = setting_widgets[setting_index("no_bwe")];
+    GtkWidget*& cert_entry = setting_widgets[setting_index("cert")];
+    GtkWidget*& key_entry = setting_widgets[setting_index("key")];
+    GtkWidget*& shutdown_grace_period_entry = setting_widgets[setting_index("shutdown_grace_period")];
+    GtkWidget*& save_log_switch = setting_widgets[setting_index("save_log")];
+    GtkWidget*& restart_on_crash_switch = setting_widgets[setting_index("restart_on_crash")];
+    GtkWidget*& socket_activation_switch = setting_widgets[setting_index("socket_activation")];
+    GtkWidget*& cpu_affinity_entry = setting_widgets[setting_index("cpu_affinity")];
+    GtkWidget*& nice_entry = setting_widgets[setting_index("nice")];
+    GtkWidget*& io_priority_class_combo_box = setting_widgets[setting_index("io_priority_class")];
+    GtkWidget*& rr_priority_entry = setting_widgets[setting_index("rr_priority")];
+
+#ifdef __linux__
+    GtkWidget* performance_group = nullptr;
+    GtkWidget* cpu_row = nullptr;
+    GtkWidget* memory_row = nullptr;
+    GtkWidget* threads_row = nullptr;
+    GtkWidget* context_switches_row = nullptr;
+    GtkWidget* io_row = nullptr;
+    GtkWidget* startup_time_row = nullptr;
+    Sparkline cpu_sparkline;
+    Sparkline memory_sparkline;
+    Sparkline context_switches_sparkline;
+    Sparkline io_sparkline;
+    Sparkline startup_time_sparkline;
+
+    ProcessMonitor monitor;
+    ProcessSample last_sample;
+    std::unordered_map<pid_t, unsigned long long> last_thread_cpu_times;
+    std::map<std::string, GtkWidget*> thread_group_rows;
+    guint monitor_source = 0;
+#endif
 
     bool new_user = false;
-    bool dirty = true;
+    bool dirty = true; // Whether saving would change anything
+    bool loaded = false; // Whether the settings have been read at least once
+    // What save() last wrote, and when, so that saving identical settings again
+    // can be skipped
+    size_t config_hash = 0;
+    std::filesystem::file_time_type config_write_time;
+
+    // The settings as last read from or written to disk, and as the rows showed them
+    // at that point. A setting that differs between the old and new file changed on
+    // disk, and one that differs between the rows then and now was edited here
+    Settings disk_settings = get_default_settings();
+    Settings applied_settings = get_default_settings();
+    bool applying_settings = false; // Keeps handle_change() from counting rows it sets as edits
+    SettingMask modified;               // The settings whose rows differ from applied_settings
+    bool config_saved = false;          // Whether config.toml holds settings for this instance
+    // Read along with config.toml, so that switching profiles only has to write it
+    std::map<std::string, SettingProfile> profiles;
+    std::string current_profile; // The profile config.toml matches, if any
+    glib::Object<GFileMonitor> config_monitor;
+    guint config_reload_source = 0;
+    unsigned long first_frame_handler = 0;
+
+    std::string instance; // The one being edited, or empty for the default
+#ifdef __linux__
+    // Every instance and its PID as of the last scan, in get_instances() order
+    std::vector<std::string> instances = {{}};
+    std::vector<pid_t> instance_pids = {-1};
+    GtkWidget* instances_group = nullptr;
+    std::vector<GtkWidget*> instance_rows;
+#endif
+
+    pid_t tenebra_pid = -1;
+#ifdef __linux__
+    int tenebra_pidfd = -1;
+    guint tenebra_pidfd_source = 0;
+    int proc_events_fd = -1;
+    std::vector<pid_t> exec_pids; // Waiting to be checked for Tenebra
+    bool exec_check_pending = false;
+#endif
+    guint tenebra_poll_source = 0;
+    guint tenebra_poll_interval = 2000; // In milliseconds
+#ifndef _WIN32
+    pid_t stopping_pid = -1;
+    int stopping_pidfd = -1; // Only ever opened on Linux
+    guint stop_wait_source = 0;
+    guint stop_kill_source = 0;
+    std::chrono::steady_clock::time_point stop_time;
+    bool stop_killed = false;
+    std::function<void(double)> on_stopped;
+
+    // Set from fork() until Tenebra accepts connections on its port
+    pid_t starting_pid = -1;
+    std::chrono::steady_clock::time_point launch_time;
+    unsigned int probe_delay = 0; // In milliseconds
+    guint probe_source = 0;
+    glib::Object<GCancellable> probe_cancellable;
+    #ifdef __linux__
+    glib::Object<GSocketConnection> probe_connection; // Held until Tenebra accepts it
+
+    // With socket activation, this window owns Tenebra's listening socket, so that
+    // connections queue in its backlog across a restart instead of being refused
+    int listen_fd = -1;
+    unsigned short listen_port = 0;
+    #endif
+
+    // Tenebra's stdout and stderr. The model only exists while the log viewer is open
+    LogBuffer log_buffer;
+    GtkStringList* log_model = nullptr;
+    GtkWidget* log_view = nullptr;
+    GtkWidget* log_scrolled_window = nullptr;
+    size_t log_model_total = 0; // log_buffer's total as of the last sync
+    unsigned int log_stream_count = 0;
+
+    GtkWidget* stream_group = nullptr;
+    std::array<GtkWidget*, metric_count> metric_rows = {};
+    std::array<Sparkline, metric_count> metric_sparklines;
+    MetricExtractor metric_extractor;
+    MetricReadings metric_readings; // The newest readings, with Sum metrics as running totals
+    guint metrics_source = 0;
+
+    // Every launch of Tenebra from this window, reaped through g_child_watch_add()
+    struct Launch {
+        pid_t pid;
+        std::string instance;
+        std::chrono::system_clock::time_point start_time;   // Only for display
+        std::chrono::steady_clock::time_point launch_time; // For run_time, which a clock change mustn't skew
+        double startup_time = -1.; // In milliseconds, or -1 if it never became ready
+        bool stopped = false;      // Whether it was asked to exit
+        bool pidfile_set = false;  // Whether its PID made it into the pidfile
+        bool exited = false;
+        int wait_status = 0;
+        double run_time = 0.; // In seconds
+    };
+    std::deque<Launch> launch_history; // Oldest first, and capped at 20
+    GtkWidget* launch_history_row = nullptr;
+    std::vector<GtkWidget*> launch_rows;
+
+    // Supervision. An incident runs from a crash until a relaunch is ready
+    guint restart_source = 0;
+    std::deque<std::chrono::steady_clock::time_point> recent_crashes; // Within the last minute
+    bool in_incident = false;
+    std::chrono::steady_clock::time_point incident_start;
+    unsigned int incidents = 0;
+    double last_downtime = 0.;  // In milliseconds
+    double total_downtime = 0.; // In milliseconds
+    GtkWidget* recovery_time_row = nullptr;
+#endif
+    std::deque<double> startup_times; // Fork-to-ready latencies in milliseconds, oldest first
+
+    unsigned int tenebra_pid_generation = 0; // Bumped whenever the state is set directly
+    bool tenebra_scan_pending = false;
+    bool tenebra_rescan = false; // Whether a request was made mid-scan
 
     void show_toast(const std::string& title, unsigned int timeout = 5) {
         AdwToast* toast = adw_toast_new(title.c_str());
@@ -72,16 +256,1106 @@ protected:
         adw_toast_overlay_add_toast(ADW_TOAST_OVERLAY(toast_overlay), toast);
     }
 
+    // Shows the header buttons for a state. The actions behind them are enabled to
+    // match, so that a remote activation can't do what the buttons wouldn't allow
+    void set_button_state(GtkWidget* child) {
+        gtk_stack_set_visible_child(GTK_STACK(button_stack), child);
+        g_simple_action_set_enabled(start_action, child == start_button);
+        g_simple_action_set_enabled(stop_action, child == running_box);
+        g_simple_action_set_enabled(restart_action, child == running_box);
+        g_simple_action_set_enabled(share_action, child == running_box);
+    }
+
+    // Records which Tenebra process is running (-1 for none) and shows the matching
+    // header buttons. On Linux the process is then watched through a pidfd, so its
+    // exit is reported the moment it happens instead of on the next /proc scan, and
+    // new instances are reported by the proc connector when it's available. Polling
+    // only covers whatever those can't
+    void set_tenebra_pid(pid_t pid) {
+        ++tenebra_pid_generation;
+        bool watched = false;
+#ifdef __linux__
+        if (tenebra_pidfd_source) {
+            g_source_remove(tenebra_pidfd_source);
+            tenebra_pidfd_source = 0;
+        }
+        if (tenebra_pidfd != -1) {
+            close(tenebra_pidfd);
+            tenebra_pidfd = -1;
+        }
+
+        if (pid != -1) {
+            if ((tenebra_pidfd = open_pidfd(pid)) != -1) {
+                tenebra_pidfd_source = g_unix_fd_add(tenebra_pidfd, G_IO_IN, [](int, GIOCondition, void* data) -> gboolean {
+                    auto tenebra = (MainWindow*) data;
+                    tenebra->tenebra_pidfd_source = 0; // Returning G_SOURCE_REMOVE destroys it
+                    tenebra->set_tenebra_pid(-1);
+                    return G_SOURCE_REMOVE;
+                },
+                    this);
+                watched = true;
+            } else if (errno == ESRCH) {
+                pid = -1; // It exited between being found and being watched
+            }
+        }
+        if (pid == -1) {
+            watched = proc_events_fd != -1;
+        }
+        if (instances.size() > 1 && proc_events_fd == -1) {
+            watched = false; // The other instances can only be polled
+        }
+#endif
+
+        if (!watched) {
+            if (pid != -1 && tenebra_poll_interval != 2000) {
+                tenebra_poll_interval = 2000; // Back to watching for an exit
+                if (tenebra_poll_source) {
+                    g_source_remove(tenebra_poll_source);
+                    tenebra_poll_source = 0;
+                }
+            }
+            poll_tenebra_pid();
+        } else if (tenebra_poll_source) {
+            g_source_remove(tenebra_poll_source);
+            tenebra_poll_source = 0;
+        }
+
+        tenebra_pid = pid;
+#ifndef _WIN32
+        if (pid != starting_pid) {
+            cancel_probe();
+        }
+#endif
+        if (pid == -1) {
+            set_button_state(start_button);
+#ifndef _WIN32
+        } else if (pid == starting_pid) {
+            set_button_state(starting_button);
+#endif
+        } else {
+            set_button_state(running_box);
+        }
+#ifdef __linux__
+        monitor_tenebra(pid);
+        update_instance_rows();
+#endif
+    }
+
+#ifndef _WIN32
+    // Tenebra can take a while to bind its port, or crash before it does, so it only
+    // counts as running once a loopback connection to the port succeeds. Attempts
+    // back off exponentially from 10 ms to 500 ms
+    void probe_tenebra() {
+    #ifdef __linux__
+        // Connecting to a socket this window holds succeeds as soon as the kernel
+        // queues the connection, so with socket activation Tenebra is only ready
+        // once it has accepted the probe's connection off that queue
+        if (probe_connection) {
+            if (get_accept_queue_length(listen_fd) > 0) {
+                retry_probe();
+            } else {
+                probe_connection.reset();
+                finish_probe();
+            }
+            return;
+        }
+    #endif
+
+        probe_cancellable = g_cancellable_new();
+        glib::Object<GSocketClient> client = g_socket_client_new();
+        g_socket_client_connect_to_host_async(client.get(), "127.0.0.1", (guint16) adw_spin_row_get_value(ADW_SPIN_ROW(port_entry)), probe_cancellable.get(), [](GObject* client, GAsyncResult* result, void* data) {
+            GError* error = nullptr;
+            glib::Object<GSocketConnection> connection = g_socket_client_connect_to_host_finish(G_SOCKET_CLIENT(client), result, &error);
+            if (error) {
+                bool cancelled = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+                g_error_free(error);
+                if (cancelled) return;
+            }
+
+            auto tenebra = (MainWindow*) data;
+            tenebra->probe_cancellable.reset();
+            if (connection) {
+    #ifdef __linux__
+                if (tenebra->listen_fd != -1 && get_accept_queue_length(tenebra->listen_fd) > 0) {
+                    tenebra->probe_connection = std::move(connection);
+                    tenebra->retry_probe();
+                    return;
+                }
+    #endif
+                tenebra->finish_probe();
+            } else {
+                tenebra->retry_probe();
+            }
+        },
+            this);
+    }
+
+    void retry_probe() {
+        if (std::chrono::steady_clock::now() - launch_time > std::chrono::seconds(30)) {
+            show_toast("Tenebra still isn't accepting connections on port " + std::to_string((unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(port_entry))) + " after 30 seconds");
+            cancel_probe();
+            set_button_state(running_box);
+        } else {
+            probe_source = g_timeout_add(probe_delay, [](void* data) -> gboolean {
+                auto tenebra = (MainWindow*) data;
+                tenebra->probe_source = 0;
+                tenebra->probe_tenebra();
+                return G_SOURCE_REMOVE;
+            },
+                this);
+            probe_delay = std::min(probe_delay * 2, 500u);
+        }
+    }
+
+    void cancel_probe() {
+        starting_pid = -1;
+        if (probe_source) {
+            g_source_remove(probe_source);
+            probe_source = 0;
+        }
+        if (probe_cancellable) {
+            g_cancellable_cancel(probe_cancellable.get());
+            probe_cancellable.reset();
+        }
+    #ifdef __linux__
+        probe_connection.reset();
+    #endif
+    }
+
+    #ifdef __linux__
+    void close_listen_socket() {
+        if (listen_fd != -1) {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+    }
+    #endif
+
+    void finish_probe() {
+        double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launch_time).count();
+        starting_pid = -1;
+        set_button_state(running_box);
+        record_startup_time(latency);
+        if (in_incident) {
+            finish_incident();
+        } else {
+            show_toast("Tenebra is ready (took " + std::to_string((long) latency) + " ms)");
+        }
+        if (!launch_history.empty()) {
+            launch_history.back().startup_time = latency;
+            update_launch_history();
+        }
+    }
+
+    void watch_launch(pid_t pid) {
+        launch_history.push_back({.pid = pid, .instance = instance, .start_time = std::chrono::system_clock::now(), .launch_time = std::chrono::steady_clock::now()});
+        if (launch_history.size() > 20) launch_history.pop_front();
+        update_launch_history();
+
+        // GLib reaps the child and hands over its wait status. On Linux it waits on a
+        // pidfd, so unlike a SIGCHLD handler no exit can be coalesced away
+        g_child_watch_add(pid, [](GPid pid, int wait_status, void* data) {
+            auto tenebra = (MainWindow*) data;
+            for (auto& launch : tenebra->launch_history) {
+                if (launch.pid == pid && !launch.exited) {
+                    launch.exited = true;
+                    launch.wait_status = wait_status;
+                    launch.run_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - launch.launch_time).count();
+                    // Anything that stops Tenebra from outside clears the pidfile, and
+                    // anything that starts another one rewrites it
+                    if (launch.pidfile_set && !is_tenebra_pidfile(pid, launch.instance)) {
+                        launch.stopped = true;
+                    }
+                    tenebra->update_launch_history();
+                    if (&launch == &tenebra->launch_history.back() && launch.instance == tenebra->instance) {
+                        if (is_crash(launch)) {
+                            tenebra->handle_crash();
+                        } else {
+                            tenebra->cancel_restart();
+                        }
+                    }
+                    break;
+                }
+            }
+            g_spawn_close_pid(pid);
+        },
+            this);
+    }
+
+    static std::string format_duration(double seconds) {
+        if (seconds < 60.) {
+            char buf[32];
+            snprintf(buf, sizeof buf, "%.1f s", seconds);
+            return buf;
+        } else if (seconds < 3600.) {
+            return std::to_string((long) seconds / 60) + " min " + std::to_string((long) seconds % 60) + " s";
+        }
+        return std::to_string((long) seconds / 3600) + " h " + std::to_string((long) seconds / 60 % 60) + " min";
+    }
+
+    // A launch counts as a crash if it exited on its own with a failure, or was
+    // killed by a signal other than the ones used to ask it to exit, like pkill's
+    static bool is_crash(const Launch& launch) {
+        if (!launch.exited || launch.stopped) {
+            return false;
+        } else if (WIFSIGNALED(launch.wait_status)) {
+            return WTERMSIG(launch.wait_status) != SIGTERM && WTERMSIG(launch.wait_status) != SIGINT;
+        }
+        return WEXITSTATUS(launch.wait_status) != EXIT_SUCCESS;
+    }
+
+    void update_launch_history() {
+        for (GtkWidget* row : launch_rows) {
+            adw_expander_row_remove(ADW_EXPANDER_ROW(launch_history_row), row);
+        }
+        launch_rows.clear();
+
+        unsigned int crashes = 0;
+        for (auto launch = launch_history.rbegin(); launch != launch_history.rend(); ++launch) {
+            char start_time[64];
+            time_t time = std::chrono::system_clock::to_time_t(launch->start_time);
+            struct tm tm;
+            strftime(start_time, sizeof start_time, "%x %X", localtime_r(&time, &tm));
+
+            std::string subtitle;
+            if (!launch->exited) {
+                subtitle = "Running";
+            } else if (WIFSIGNALED(launch->wait_status)) {
+                subtitle = std::string("Killed by ") + strsignal(WTERMSIG(launch->wait_status)) + " after " + format_duration(launch->run_time);
+            } else {
+                subtitle = "Exited with code " + std::to_string(WEXITSTATUS(launch->wait_status)) + " after " + format_duration(launch->run_time);
+            }
+            if (launch->startup_time >= 0.) {
+                subtitle += ", ready in " + std::to_string((long) launch->startup_time) + " ms";
+            } else if (launch->exited) {
+                subtitle += ", never ready";
+            }
+
+            GtkWidget* row = adw_action_row_new();
+            adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row), launch->instance.empty() ? start_time : (start_time + (" · " + launch->instance)).c_str());
+            adw_action_row_set_subtitle(ADW_ACTION_ROW(row), subtitle.c_str());
+            if (is_crash(*launch)) {
+                gtk_widget_add_css_class(row, "error");
+                ++crashes;
+            }
+            adw_expander_row_add_row(ADW_EXPANDER_ROW(launch_history_row), row);
+            launch_rows.push_back(row);
+        }
+
+        if (launch_history.empty()) {
+            adw_expander_row_set_subtitle(ADW_EXPANDER_ROW(launch_history_row), "Nothing launched yet");
+        } else {
+            adw_expander_row_set_subtitle(ADW_EXPANDER_ROW(launch_history_row), (std::to_string(launch_history.size()) + (launch_history.size() == 1 ? " launch, " : " launches, ") + std::to_string(crashes) + (crashes == 1 ? " crash" : " crashes")).c_str());
+        }
+        gtk_widget_set_sensitive(launch_history_row, !launch_history.empty());
+    }
+
+    // Relaunches Tenebra after a crash if supervision is on. The first restart is
+    // immediate, since most crashes are one-offs, and each further crash within a
+    // minute doubles the delay from 250 ms. A fifth crash within a minute is taken
+    // as a crash loop, and supervision waits for Tenebra to be started manually
+    void handle_crash() {
+        if (!adw_switch_row_get_active(ADW_SWITCH_ROW(restart_on_crash_switch)) || restart_source) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (!in_incident) {
+            in_incident = true;
+            incident_start = now;
+        }
+        recent_crashes.push_back(now);
+        while (now - recent_crashes.front() > std::chrono::minutes(1)) {
+            recent_crashes.pop_front();
+        }
+
+        if (recent_crashes.size() >= 5) {
+            show_toast("Tenebra crashed " + std::to_string(recent_crashes.size()) + " times in a minute, so it won't be restarted until it's started manually", 0);
+            cancel_restart();
+            return;
+        }
+
+        unsigned int delay = recent_crashes.size() == 1 ? 0 : 250 << (recent_crashes.size() - 2);
+        if (delay) {
+            show_toast("Tenebra crashed, restarting in " + std::to_string(delay) + " ms");
+        }
+        restart_source = g_timeout_add(delay, [](void* data) -> gboolean {
+            auto tenebra = (MainWindow*) data;
+            tenebra->restart_source = 0;
+            if (tenebra->launch() == -1) {
+                tenebra->in_incident = false;
+            }
+            return G_SOURCE_REMOVE;
+        },
+            this);
+    }
+
+    void cancel_restart() {
+        if (restart_source) {
+            g_source_remove(restart_source);
+            restart_source = 0;
+        }
+        recent_crashes.clear();
+        in_incident = false;
+    }
+
+    void finish_incident() {
+        in_incident = false;
+        last_downtime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - incident_start).count();
+        total_downtime += last_downtime;
+        ++incidents;
+        update_recovery_time_row();
+        show_toast("Tenebra recovered from a crash (down for " + std::to_string((long) last_downtime) + " ms)");
+    }
+
+    void update_recovery_time_row() {
+        if (incidents) {
+            adw_action_row_set_subtitle(ADW_ACTION_ROW(recovery_time_row), (std::to_string((long) last_downtime) + " ms (mean " + std::to_string((long) (total_downtime / incidents)) + " ms over " + std::to_string(incidents) + (incidents == 1 ? " incident)" : " incidents)")).c_str());
+        }
+        gtk_widget_set_visible(recovery_time_row, incidents);
+    }
+
+    // Follows the file Tenebra's output goes to until Tenebra has exited and all
+    // it wrote has been read. Regular files always poll readable, so the file is
+    // checked on a timer, and each check reads whatever was appended since
+    void capture_log(int fd, pid_t pid) {
+        struct LogStream {
+            MainWindow* tenebra;
+            int fd;
+            pid_t pid;
+            std::string partial;
+            off_t offset = 0;   // How much has been read
+            off_t released = 0; // How much has been handed back to the filesystem
+        };
+
+        g_timeout_add_full(G_PRIORITY_DEFAULT, 100, [](void* data) -> gboolean {
+            auto stream = (LogStream*) data;
+            // Checked before reading, so that anything written before the exit is read.
+            // Until the child watch reaps it, Tenebra still counts as running
+            bool exited = kill(stream->pid, 0) == -1 && errno == ESRCH;
+
+            // At most 1 MiB a check, so that a flood can't stall the main loop
+            char buf[65536];
+            ssize_t size = 0;
+            for (int i = 0; i < 16 && (size = read(stream->fd, buf, sizeof buf)) > 0; ++i) {
+                stream->tenebra->handle_log(stream->partial, std::string_view(buf, size));
+                stream->offset += size;
+            }
+    #ifdef __linux__
+            // The file's size keeps growing, but what's been read no longer takes up disk
+            if (stream->offset - stream->released >= 1 << 20 && !fallocate(stream->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, stream->offset)) {
+                stream->released = stream->offset;
+            }
+    #endif
+
+            if (!(exited && size == 0) && !(size == -1 && errno != EINTR)) {
+                return G_SOURCE_CONTINUE;
+            }
+            stream->tenebra->handle_log(stream->partial, {}, true);
+            return G_SOURCE_REMOVE;
+        },
+            new LogStream {this, fd, pid},
+            [](void* data) {
+                auto stream = (LogStream*) data;
+                close(stream->fd);
+                if (!--stream->tenebra->log_stream_count) {
+                    stream->tenebra->stop_metrics();
+                }
+                delete stream;
+            });
+
+        if (!log_stream_count++) {
+            metrics_source = g_timeout_add_seconds(1, [](void* data) -> gboolean {
+                auto tenebra = (MainWindow*) data;
+                tenebra->update_metrics();
+                return G_SOURCE_CONTINUE;
+            },
+                this);
+        }
+    }
+
+    void handle_log(std::string& partial, std::string_view data, bool flush = false) {
+        size_t total = log_buffer.get_total();
+        log_buffer.append(partial, data, flush);
+        for (size_t i = log_buffer.size() - std::min(log_buffer.get_total() - total, log_buffer.size()); i < log_buffer.size(); ++i) {
+            metric_extractor.feed(log_buffer[i]);
+        }
+        sync_log_model();
+    }
+
+    // Charts what Tenebra logged over the last second. Gauges carry their newest
+    // reading forward, while Sum metrics chart how many arrived that second
+    void update_metrics() {
+        MetricReadings readings = metric_extractor.take();
+        for (size_t i = 0; i < metric_count; ++i) {
+            if (!readings[i].matched && !metric_readings[i].matched) continue;
+
+            double point;
+            std::string subtitle;
+            if (metric_rules[i].aggregation == MetricAggregation::Sum) {
+                point = readings[i].matched ? readings[i].value : 0.;
+                metric_readings[i].matched = true;
+                metric_readings[i].value += point;
+                subtitle = format_metric(metric_readings[i].value) + " total";
+            } else {
+                if (readings[i].matched) metric_readings[i] = readings[i];
+                point = metric_readings[i].value;
+                subtitle = format_metric(point);
+                if (metric_readings[i].unit[0]) {
+                    subtitle += ' ';
+                    subtitle += metric_readings[i].unit;
+                }
+            }
+
+            metric_sparklines[i].push(point);
+            adw_action_row_set_subtitle(ADW_ACTION_ROW(metric_rows[i]), subtitle.c_str());
+            gtk_widget_set_visible(metric_rows[i], TRUE);
+            gtk_widget_set_visible(stream_group, TRUE);
+        }
+    }
+
+    // Called once Tenebra's output closes, since its readings no longer describe
+    // anything that's running
+    void stop_metrics() {
+        if (metrics_source) {
+            g_source_remove(metrics_source);
+            metrics_source = 0;
+        }
+        metric_extractor.take();
+        metric_readings = {};
+        for (size_t i = 0; i < metric_count; ++i) {
+            metric_sparklines[i].clear();
+            gtk_widget_set_visible(metric_rows[i], FALSE);
+        }
+        gtk_widget_set_visible(stream_group, FALSE);
+    }
+
+    static std::string format_metric(double value) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%.*f", value < 100. ? 1 : 0, value);
+        return buf;
+    }
+
+    // Brings log_model up to date with log_buffer while the log viewer is open.
+    // The view only follows new lines if it was already scrolled to the bottom
+    void sync_log_model() {
+        if (!log_model) return;
+
+        size_t new_lines = std::min(log_buffer.get_total() - log_model_total, log_buffer.size());
+        log_model_total = log_buffer.get_total();
+        if (!new_lines) return;
+
+        GtkAdjustment* adjustment = gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(log_scrolled_window));
+        bool following = gtk_adjustment_get_value(adjustment) + gtk_adjustment_get_page_size(adjustment) >= gtk_adjustment_get_upper(adjustment) - 1.;
+
+        std::vector<const char*> lines;
+        lines.reserve(new_lines + 1);
+        for (size_t i = log_buffer.size() - new_lines; i < log_buffer.size(); ++i) {
+            lines.push_back(log_buffer[i].c_str());
+        }
+        lines.push_back(nullptr);
+
+        // Evicted lines are dropped from the front so the model never outgrows the buffer
+        guint n_items = g_list_model_get_n_items(G_LIST_MODEL(log_model));
+        guint evicted = n_items + new_lines > log_buffer.size() ? n_items + new_lines - log_buffer.size() : 0;
+        gtk_string_list_splice(log_model, 0, evicted, nullptr);
+        gtk_string_list_splice(log_model, n_items - evicted, 0, lines.data());
+
+        if (following) {
+            gtk_list_view_scroll_to(GTK_LIST_VIEW(log_view), log_buffer.size() - 1, GTK_LIST_SCROLL_NONE, nullptr);
+        }
+    }
+
+    // Only the rows on screen are ever realized, so opening the viewer on a full
+    // buffer costs the same as opening it on an empty one
+    void show_logs() {
+        GtkListItemFactory* factory = gtk_signal_list_item_factory_new();
+        glib::connect_signal<GObject*>(factory, "setup", [](GtkListItemFactory*, GObject* item) {
+            GtkWidget* label = gtk_label_new(nullptr);
+            gtk_label_set_xalign(GTK_LABEL(label), 0.f);
+            gtk_list_item_set_child(GTK_LIST_ITEM(item), label);
+        });
+        glib::connect_signal<GObject*>(factory, "bind", [](GtkListItemFactory*, GObject* item) {
+            gtk_label_set_text(GTK_LABEL(gtk_list_item_get_child(GTK_LIST_ITEM(item))), gtk_string_object_get_string(GTK_STRING_OBJECT(gtk_list_item_get_item(GTK_LIST_ITEM(item)))));
+        });
+
+        log_model = gtk_string_list_new(nullptr);
+        log_model_total = log_buffer.get_total() - log_buffer.size();
+        log_view = gtk_list_view_new(GTK_SELECTION_MODEL(gtk_no_selection_new(G_LIST_MODEL(log_model))), factory);
+        gtk_widget_add_css_class(log_view, "monospace");
+
+        log_scrolled_window = gtk_scrolled_window_new();
+        gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(log_scrolled_window), log_view);
+
+        GtkWidget* toolbar_view = adw_toolbar_view_new();
+        adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(toolbar_view), adw_header_bar_new());
+        adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(toolbar_view), log_scrolled_window);
+
+        AdwDialog* dialog = adw_dialog_new();
+        adw_dialog_set_title(dialog, "Logs");
+        adw_dialog_set_content_width(dialog, 800);
+        adw_dialog_set_content_height(dialog, 600);
+        adw_dialog_set_child(dialog, toolbar_view);
+        glib::connect_signal(dialog, "closed", [this](AdwDialog*) {
+            log_model = nullptr;
+            log_view = nullptr;
+            log_scrolled_window = nullptr;
+        });
+        adw_dialog_present(dialog, window);
+
+        sync_log_model(); // The empty view counts as scrolled to the bottom, so this starts at the newest line
+    }
+#endif
+
+    // Keeps the last 50 time-to-serve measurements in the config directory, so that
+    // a regression in Tenebra's startup time shows up across launches
+    void load_startup_times() {
+        auto config_path = get_config_path(instance);
+        if (config_path.empty()) return;
+
+        std::ifstream history_file(config_path / "startup_history");
+        for (double latency; history_file >> latency;) {
+            startup_times.push_back(latency);
+            if (startup_times.size() > 50) startup_times.pop_front();
+        }
+        update_startup_time_row();
+    }
+
+    void record_startup_time(double latency) {
+        startup_times.push_back(latency);
+        if (startup_times.size() > 50) startup_times.pop_front();
+        update_startup_time_row();
+
+        auto config_path = get_config_path(instance);
+        if (!config_path.empty()) {
+            std::string history;
+            for (double startup_time : startup_times) {
+                history += std::to_string((long) startup_time) + '\n';
+            }
+            write_file_atomically(config_path / "startup_history", history);
+        }
+    }
+
+    void update_startup_time_row() {
+#ifdef __linux__
+        startup_time_sparkline.clear();
+        for (double startup_time : startup_times) {
+            startup_time_sparkline.push(startup_time);
+        }
+
+        if (startup_times.empty()) {
+            adw_action_row_set_subtitle(ADW_ACTION_ROW(startup_time_row), "Not measured yet");
+        } else {
+            std::vector<double> sorted_startup_times(startup_times.begin(), startup_times.end());
+            std::sort(sorted_startup_times.begin(), sorted_startup_times.end());
+            double median = sorted_startup_times[sorted_startup_times.size() / 2];
+            adw_action_row_set_subtitle(ADW_ACTION_ROW(startup_time_row), (std::to_string((long) startup_times.back()) + " ms (median " + std::to_string((long) median) + " ms over " + std::to_string(startup_times.size()) + " launches)").c_str());
+        }
+#endif
+    }
+
+#ifdef __linux__
+    static std::string format_size(unsigned long long size) {
+        char* str = g_format_size_full(size, G_FORMAT_SIZE_IEC_UNITS);
+        std::string ret = str;
+        g_free(str);
+        return ret;
+    }
+
+    // Shows the Performance group while pid is running, sampling it once a second
+    // for as long as the window is visible
+    void monitor_tenebra(pid_t pid) {
+        if (pid == monitor.get_pid()) return;
+
+        if (monitor_source) {
+            g_source_remove(monitor_source);
+            monitor_source = 0;
+        }
+        cpu_sparkline.clear();
+        memory_sparkline.clear();
+        context_switches_sparkline.clear();
+        io_sparkline.clear();
+        for (const auto& [comm, row] : thread_group_rows) {
+            adw_expander_row_remove(ADW_EXPANDER_ROW(threads_row), row);
+        }
+        thread_group_rows.clear();
+        last_thread_cpu_times.clear();
+
+        if (pid != -1 && monitor.open(pid) != -1 && monitor.sample(last_sample) != -1) {
+            std::vector<ThreadSample> threads;
+            monitor.sample_threads(threads);
+            for (const auto& thread : threads) {
+                last_thread_cpu_times[thread.tid] = thread.cpu_time;
+            }
+
+            gtk_widget_set_visible(performance_group, TRUE);
+            monitor_source = g_timeout_add(1000, [](void* data) -> gboolean {
+                auto tenebra = (MainWindow*) data;
+                if (gtk_widget_is_visible(tenebra->window)) {
+                    tenebra->sample_tenebra();
+                }
+                return G_SOURCE_CONTINUE;
+            },
+                this);
+        } else {
+            monitor.close();
+            gtk_widget_set_visible(performance_group, FALSE);
+        }
+    }
+
+    void sample_tenebra() {
+        ProcessSample sample;
+        if (monitor.sample(sample) == -1) {
+            return; // The pidfd watch will report the exit
+        }
+
+        double elapsed = std::chrono::duration<double>(sample.time - last_sample.time).count();
+        if (elapsed <= 0.) return;
+
+        char str[64];
+        double cpu_usage = get_cpu_usage(last_sample, sample);
+        snprintf(str, sizeof str, "%.1f%%", cpu_usage);
+        adw_action_row_set_subtitle(ADW_ACTION_ROW(cpu_row), str);
+        cpu_sparkline.push(cpu_usage);
+
+        adw_action_row_set_subtitle(ADW_ACTION_ROW(memory_row), format_size(sample.rss).c_str());
+        memory_sparkline.push(sample.rss);
+
+        std::vector<ThreadSample> threads;
+        monitor.sample_threads(threads);
+        update_thread_breakdown(threads, sample.threads, elapsed);
+
+        double context_switches = (sample.voluntary_context_switches + sample.involuntary_context_switches -
+                                      last_sample.voluntary_context_switches - last_sample.involuntary_context_switches) /
+                                  elapsed;
+        double involuntary_context_switches = (sample.involuntary_context_switches - last_sample.involuntary_context_switches) / elapsed;
+        snprintf(str, sizeof str, "%.0f/s (%.0f/s involuntary)", context_switches, involuntary_context_switches);
+        adw_action_row_set_subtitle(ADW_ACTION_ROW(context_switches_row), str);
+        context_switches_sparkline.push(context_switches);
+
+        gtk_widget_set_visible(io_row, sample.has_io);
+        if (sample.has_io && last_sample.has_io) {
+            double read_rate = (sample.read_bytes - last_sample.read_bytes) / elapsed;
+            double write_rate = (sample.write_bytes - last_sample.write_bytes) / elapsed;
+            adw_action_row_set_subtitle(ADW_ACTION_ROW(io_row), (format_size(read_rate) + "/s read, " + format_size(write_rate) + "/s written").c_str());
+            io_sparkline.push(read_rate + write_rate);
+        }
+
+        last_sample = sample;
+    }
+
+    // Groups threads by name, so that a pool of encoder workers reads as one line,
+    // and flags any single thread that's pinning a core
+    void update_thread_breakdown(const std::vector<ThreadSample>& threads, unsigned int total_threads, double elapsed) {
+        static const long ticks_per_second = sysconf(_SC_CLK_TCK);
+
+        struct ThreadGroup {
+            unsigned int count = 0;
+            double cpu_usage = 0.;
+            double max_cpu_usage = 0.;
+        };
+        std::map<std::string, ThreadGroup> groups;
+
+        std::unordered_map<pid_t, unsigned long long> thread_cpu_times;
+        for (const auto& thread : threads) {
+            ThreadGroup& group = groups[thread.comm];
+            ++group.count;
+            if (auto it = last_thread_cpu_times.find(thread.tid); it != last_thread_cpu_times.end()) {
+                double cpu_usage = (thread.cpu_time - it->second) / (double) ticks_per_second / elapsed * 100.;
+                group.cpu_usage += cpu_usage;
+                group.max_cpu_usage = std::max(group.max_cpu_usage, cpu_usage);
+            }
+            thread_cpu_times[thread.tid] = thread.cpu_time;
+        }
+        last_thread_cpu_times = std::move(thread_cpu_times);
+
+        for (auto it = thread_group_rows.begin(); it != thread_group_rows.end();) {
+            if (!groups.count(it->first)) {
+                adw_expander_row_remove(ADW_EXPANDER_ROW(threads_row), it->second);
+                it = thread_group_rows.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        std::string saturated_groups;
+        for (const auto& [comm, group] : groups) {
+            GtkWidget*& row = thread_group_rows[comm];
+            if (!row) {
+                row = adw_action_row_new();
+                adw_preferences_row_set_use_markup(ADW_PREFERENCES_ROW(row), FALSE); // Thread names are arbitrary
+                adw_expander_row_add_row(ADW_EXPANDER_ROW(threads_row), row);
+            }
+
+            char str[128];
+            if (group.count > 1) {
+                adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row), (comm + " (" + std::to_string(group.count) + " threads)").c_str());
+                snprintf(str, sizeof str, "%.1f%% total, %.1f%% busiest thread", group.cpu_usage, group.max_cpu_usage);
+            } else {
+                adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row), comm.c_str());
+                snprintf(str, sizeof str, "%.1f%%", group.cpu_usage);
+            }
+            adw_action_row_set_subtitle(ADW_ACTION_ROW(row), str);
+
+            if (group.max_cpu_usage >= 90.) {
+                gtk_widget_add_css_class(row, "error");
+                if (!saturated_groups.empty()) saturated_groups += ", ";
+                saturated_groups += comm;
+            } else {
+                gtk_widget_remove_css_class(row, "error");
+            }
+        }
+
+        std::string subtitle = std::to_string(total_threads);
+        if (threads.size() < total_threads) {
+            subtitle += " (breakdown of the first " + std::to_string(threads.size()) + ')';
+        }
+        if (!saturated_groups.empty()) {
+            subtitle += " · Saturated: " + saturated_groups;
+        }
+        adw_expander_row_set_subtitle(ADW_EXPANDER_ROW(threads_row), subtitle.c_str());
+    }
+#endif
+
+    // Looks up the Tenebra process on a worker thread and publishes the result from
+    // the main loop. Requests made while a scan is already in flight share its
+    // result, and a result that predates a start() or stop() is dropped as stale.
+    // On Linux every instance is looked up by the same scan
+    void refresh_tenebra_pid() {
+        if (tenebra_scan_pending) {
+            tenebra_rescan = true;
+            return;
+        }
+        tenebra_scan_pending = true;
+
+        struct Scan {
+            unsigned int generation;
+            std::vector<std::string> instances;
+            std::vector<pid_t> pids;
+        };
+
+        GTask* task = g_task_new(nullptr, nullptr, [](GObject*, GAsyncResult* result, void* data) {
+            auto tenebra = (MainWindow*) data;
+            auto scan = (Scan*) g_task_get_task_data(G_TASK(result));
+            tenebra->tenebra_scan_pending = false;
+
+            pid_t pid = -1;
+            for (size_t i = 0; i < scan->instances.size(); ++i) {
+                if (scan->instances[i] == tenebra->instance) pid = scan->pids[i];
+            }
+#ifdef __linux__
+            tenebra->instances = std::move(scan->instances);
+            tenebra->instance_pids = std::move(scan->pids);
+            tenebra->update_instance_rows();
+#endif
+
+            if (scan->generation == tenebra->tenebra_pid_generation) {
+                tenebra->tenebra_rescan = false;
+                tenebra->set_tenebra_pid(pid);
+            } else if (std::exchange(tenebra->tenebra_rescan, false)) {
+                tenebra->refresh_tenebra_pid(); // This result was dropped, but the request still needs one
+            }
+        },
+            this);
+        g_task_set_task_data(task, new Scan {tenebra_pid_generation, {instance}, {}}, [](void* data) {
+            delete (Scan*) data;
+        });
+        g_task_run_in_thread(task, [](GTask* task, void*, void* task_data, GCancellable*) {
+            auto scan = (Scan*) task_data;
+#ifdef __linux__
+            scan->instances = get_instances();
+            scan->pids = get_tenebra_pids(scan->instances);
+#else
+            scan->pids = {get_tenebra_pid(scan->instances[0])};
+#endif
+            g_task_return_boolean(task, TRUE);
+        });
+        g_object_unref(task);
+    }
+
+#ifdef __linux__
+    // Sorts the processes in exec_pids into Tenebra instances on a worker thread.
+    // Only once that's done does anything reach the main thread, and execs that
+    // arrive in the meantime are batched for the next check
+    void check_exec_pids() {
+        if (exec_check_pending || exec_pids.empty()) return;
+        exec_check_pending = true;
+
+        struct ExecCheck {
+            std::vector<pid_t> pids;
+            std::vector<std::pair<pid_t, std::string>> found; // Tenebra processes and their instances
+        };
+
+        GTask* task = g_task_new(nullptr, nullptr, [](GObject*, GAsyncResult* result, void* data) {
+            auto tenebra = (MainWindow*) data;
+            auto check = (ExecCheck*) g_task_get_task_data(G_TASK(result));
+            tenebra->exec_check_pending = false;
+
+            bool rescan = false; // For the instances that aren't being edited
+            for (const auto& [pid, instance] : check->found) {
+                if (tenebra->tenebra_pid == -1 && instance == tenebra->instance) {
+                    tenebra->set_tenebra_pid(pid);
+                } else if (pid != tenebra->tenebra_pid) {
+                    rescan = true;
+                }
+            }
+            if (rescan) tenebra->refresh_tenebra_pid();
+            tenebra->check_exec_pids();
+        },
+            this);
+        g_task_set_task_data(task, new ExecCheck {std::exchange(exec_pids, {}), {}}, [](void* data) {
+            delete (ExecCheck*) data;
+        });
+        g_task_run_in_thread(task, [](GTask* task, void*, void* task_data, GCancellable*) {
+            auto check = (ExecCheck*) task_data;
+            for (pid_t pid : check->pids) {
+                if (is_tenebra_pid(pid)) {
+                    std::string instance = get_tenebra_instance(pid);
+                    set_tenebra_pidfile(pid, instance);
+                    check->found.push_back({pid, std::move(instance)});
+                }
+            }
+            g_task_return_boolean(task, TRUE);
+        });
+        g_object_unref(task);
+    }
+#endif
+
+    // The PID to signal. A pidfd-watched PID is known to be current, but anything
+    // else may be stale by now, and signalling a recycled PID would hit some other
+    // process, so that case is looked up again
+    pid_t get_current_tenebra_pid() {
+#ifdef __linux__
+        if (tenebra_pidfd != -1) return tenebra_pid;
+#endif
+        return get_tenebra_pid(instance);
+    }
+
+#ifdef __linux__
+    void update_instance_rows() {
+        for (GtkWidget* row : instance_rows) {
+            adw_preferences_group_remove(ADW_PREFERENCES_GROUP(instances_group), row);
+        }
+        instance_rows.clear();
+
+        for (size_t i = 0; i < instances.size(); ++i) {
+            std::string name = instances[i];
+            bool current = name == instance;
+            pid_t pid = current ? tenebra_pid : instance_pids[i];
+
+            GtkWidget* row = adw_action_row_new();
+            adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row), name.empty() ? "Default" : name.c_str());
+            adw_action_row_set_subtitle(ADW_ACTION_ROW(row), pid == -1 ? "Stopped" : ("Running (PID " + std::to_string(pid) + ')').c_str());
+            if (current) {
+                GtkWidget* icon = gtk_image_new_from_icon_name("object-select-symbolic");
+                gtk_widget_set_tooltip_text(icon, "Editing");
+                adw_action_row_add_suffix(ADW_ACTION_ROW(row), icon);
+            } else {
+                // Starting goes through the editor, since launch() works from the
+                // settings shown. Stopping goes straight to SIGTERM, since this
+                // window has no grace period to enforce for an instance it isn't
+                // editing
+                GtkWidget* button = gtk_button_new_from_icon_name(pid == -1 ? "media-playback-start-symbolic" : "media-playback-stop-symbolic");
+                gtk_widget_set_tooltip_text(button, pid == -1 ? "Edit and Start" : "Stop");
+                gtk_widget_set_valign(button, GTK_ALIGN_CENTER);
+                gtk_widget_add_css_class(button, "flat");
+                glib::connect_signal(button, "clicked", [this, name, pid](GtkWidget*) {
+                    if (pid == -1) {
+                        switch_instance(name, [this]() {
+                            start();
+                        });
+                        return;
+                    }
+
+                    // The PID shown is from the last refresh, so it's looked up again
+                    int pidfd = -1;
+                    int result = 1;
+                    if (pid_t live_pid = get_tenebra_pid(name); live_pid != -1 && (result = terminate_tenebra(live_pid, name, pidfd)) == -1) {
+                        show_toast("Failed to stop Tenebra (kill failed, error " + std::to_string(errno) + ')');
+                    } else if (result == 1) {
+                        refresh_tenebra_pid(); // It's already gone
+                    }
+                    if (pidfd != -1) close(pidfd);
+                });
+                adw_action_row_add_suffix(ADW_ACTION_ROW(row), button);
+
+                gtk_list_box_row_set_activatable(GTK_LIST_BOX_ROW(row), TRUE);
+                glib::connect_signal(row, "activated", [this, name](GtkWidget*) {
+                    switch_instance(name);
+                });
+            }
+            adw_preferences_group_add(ADW_PREFERENCES_GROUP(instances_group), row);
+            instance_rows.push_back(row);
+        }
+    }
+
+    // Points the window at another instance. Whatever was started for the previous
+    // one keeps running, but it's no longer probed or restarted after a crash
+    void switch_instance(const std::string& instance, std::function<void()> on_switched = nullptr) {
+        if (!loaded) {
+            return; // The rows are still being filled in
+        } else if (instance == this->instance) {
+            if (on_switched) on_switched();
+            return;
+        } else if (stopping_pid != -1) {
+            show_toast("Wait for Tenebra to stop before switching instances");
+            return;
+        } else if (dirty) {
+            AdwDialog* dialog = adw_alert_dialog_new("Save Changes?", "You have unsaved changes. Changes that are not saved will be permanently lost.");
+            adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(dialog), "cancel", "Cancel", "discard", "Discard", "save", "Save", nullptr);
+            adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog), "discard", ADW_RESPONSE_DESTRUCTIVE);
+            adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog), "save", ADW_RESPONSE_SUGGESTED);
+            adw_alert_dialog_set_default_response(ADW_ALERT_DIALOG(dialog), "save");
+            adw_alert_dialog_set_close_response(ADW_ALERT_DIALOG(dialog), "cancel");
+            glib::connect_signal<char*>(dialog, "response", [this, instance, on_switched](AdwDialog*, char* response) {
+                if (!strcmp(response, "save")) {
+                    if (!save(false)) switch_instance(instance, on_switched);
+                } else if (!strcmp(response, "discard")) {
+                    dirty = false;
+                    switch_instance(instance, on_switched);
+                }
+            });
+            adw_dialog_present(dialog, window);
+            return;
+        }
+
+        cancel_restart();
+        cancel_probe();
+        close_listen_socket();
+        this->instance = instance;
+        gtk_window_set_title(GTK_WINDOW(window), instance.empty() ? "Tenebra" : ("Tenebra (" + instance + ')').c_str());
+        adw_action_row_set_subtitle(ADW_ACTION_ROW(save_log_switch), ("Also writes Tenebra's output to " + (get_config_path(instance) / "tenebra.log").string() + ", rotated at 1 MiB").c_str());
+        startup_times.clear();
+        load_startup_times();
+        config_hash = 0; // It was for the other instance's file
+        disk_settings = applied_settings = get_default_settings();
+        watch_config();
+        set_tenebra_pid(-1); // Until the scan started by refresh() finds this instance's process
+
+        if (std::filesystem::exists(get_config_path(instance) / "config.toml")) {
+            refresh();
+        } else {
+            // A new instance starts out with the settings that were on screen
+            refresh_tenebra_pid();
+            load_profiles();
+            applied_settings = get_settings();
+            config_saved = false;
+            for (size_t i = 0; i < setting_count; ++i) {
+                set_modified(i, false);
+            }
+            show_toast("Give this instance its own port and capture region before starting it");
+        }
+        if (on_switched) on_switched();
+    }
+
+    void show_new_instance_dialog() {
+        AdwDialog* dialog = adw_alert_dialog_new("New Instance", "Each instance has its own settings and process, so that several monitors can be streamed at once");
+        GtkWidget* name_entry = gtk_entry_new();
+        gtk_entry_set_placeholder_text(GTK_ENTRY(name_entry), "Name");
+        gtk_entry_set_activates_default(GTK_ENTRY(name_entry), TRUE);
+        adw_alert_dialog_set_extra_child(ADW_ALERT_DIALOG(dialog), name_entry);
+        adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(dialog), "cancel", "Cancel", "create", "Create", nullptr);
+        adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog), "create", ADW_RESPONSE_SUGGESTED);
+        adw_alert_dialog_set_default_response(ADW_ALERT_DIALOG(dialog), "create");
+        adw_alert_dialog_set_close_response(ADW_ALERT_DIALOG(dialog), "cancel");
+        glib::connect_signal<char*>(dialog, "response", [this, name_entry](AdwDialog*, char* response) {
+            if (strcmp(response, "create")) return;
+
+            std::string name = gtk_editable_get_text(GTK_EDITABLE(name_entry));
+            std::error_code ec;
+            if (!is_valid_instance_name(name)) {
+                show_toast("Instance names may only contain letters, digits, '-', '_' and '.'");
+            } else if (std::find(instances.begin(), instances.end(), name) != instances.end()) {
+                show_toast("There's already an instance named " + name);
+            } else if (std::filesystem::create_directories(get_config_path(name), ec), ec) {
+                show_toast("Failed to create " + get_config_path(name).string() + " (" + ec.message() + ')');
+            } else {
+                switch_instance(name);
+            }
+        });
+        adw_dialog_present(dialog, window);
+    }
+#endif
+
+    // Used where there's nothing to wait on (no pidfds or proc connector, or a
+    // Windows service), so the process table is rescanned instead. That's every
+    // couple of seconds while Tenebra runs, so that its exit is noticed promptly.
+    // While it's stopped, the scan only looks for a Tenebra started elsewhere, so
+    // the interval doubles up to 10 s rather than scanning at a fixed rate, and is
+    // reset whenever the window is focused
+    void poll_tenebra_pid() {
+        if (!tenebra_poll_source) {
+            tenebra_poll_source = g_timeout_add(tenebra_poll_interval, [](void* data) -> gboolean {
+                auto tenebra = (MainWindow*) data;
+                if (gtk_widget_is_visible(tenebra->window)) {
+                    tenebra->refresh_tenebra_pid();
+                }
+                if (tenebra->tenebra_pid == -1 && tenebra->tenebra_poll_interval < 10000) {
+                    tenebra->tenebra_poll_interval = std::min(tenebra->tenebra_poll_interval * 2, 10000u);
+                    tenebra->tenebra_poll_source = 0;
+                    tenebra->poll_tenebra_pid();
+                    return G_SOURCE_REMOVE;
+                }
+                return G_SOURCE_CONTINUE;
+            },
+                this);
+        }
+    }
+
+    void restart() {
+        stop(false, [this](double latency) {
+            if (!start()) {
+                show_toast("Tenebra has been restarted (stopped in " + std::to_string((long) latency) + " ms)");
+            }
+        });
+    }
+
+    std::string get_share_address() {
+        return get_common_name_from_cert(gtk_editable_get_text(GTK_EDITABLE(cert_entry))) + ':' + std::to_string((unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(port_entry)));
+    }
+
+    // Asks Tenebra for a one-time key and copies a link that uses it
+    int copy_link(const std::string& address, bool view_only) {
+        json req_json = {
+            {"password", gtk_editable_get_text(GTK_EDITABLE(password_entry))},
+            {"view_only", view_only},
+        };
+
+        pn::TLSContext tls_context;
+        if (pn::Status result = tls_context.init_client(SSL_VERIFY_NONE); !result) {
+            show_toast("Failed to create one-time link key: " + result.error().message());
+            return -1;
+        }
+
+        pw::Response resp;
+        if (pn::Status result = pw::fetch("POST", "https://127.0.0.1:" + std::to_string((unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(port_entry))) + "/create_key", resp, req_json.dump(), {{"Content-Type", "application/json"}}, {.tls_context = &tls_context}); !result) {
+            show_toast("Failed to create one-time link key: " + result.error().message());
+            return -1;
+        } else if (resp.status_code != 200) {
+            show_toast("Failed to create one-time link key: Response has status code " + std::to_string(resp.status_code));
+            return -1;
+        }
+
+        pw::URLInfo url_info;
+        url_info.scheme = "https";
+        url_info.host = "audacia.duckdns.org";
+        *url_info.query_parameters = {
+            {"address", address},
+            {"key", resp.body_string()},
+            {"view_only", view_only ? "true" : "false"},
+        };
+        gdk_clipboard_set_text(gdk_display_get_clipboard(gtk_widget_get_display(window)), url_info.build().c_str());
+
+        show_toast("Copied one-time access link to clipboard");
+        return 0;
+    }
+
 public:
     MainWindow() = default;
 
     void handle_activate(AdwApplication* app) {
         if (window) {
-            if (get_tenebra_pid() == -1) {
-                gtk_stack_set_visible_child(GTK_STACK(button_stack), start_button);
-            } else {
-                gtk_stack_set_visible_child(GTK_STACK(button_stack), running_box);
-            }
+            refresh_tenebra_pid();
             gtk_widget_set_visible(window, TRUE);
             return;
         }
@@ -90,11 +1364,10 @@ public:
         gtk_window_set_title(GTK_WINDOW(window), "Tenebra");
         gtk_window_set_default_size(GTK_WINDOW(window), 740, 700);
 
-        GSimpleAction* save_action = g_simple_action_new("save", nullptr);
+        save_action = g_simple_action_new("save", nullptr);
         glib::connect_signal<GVariant*>(save_action, "activate", [this](GSimpleAction*, GVariant*) {
             save();
         });
-        g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(save_action));
         {
 #ifdef __APPLE__
             const char* accels[] = {"<Meta>S", nullptr};
@@ -104,11 +1377,10 @@ public:
             gtk_application_set_accels_for_action(GTK_APPLICATION(app), "app.save", accels);
         }
 
-        GSimpleAction* refresh_action = g_simple_action_new("refresh", nullptr);
+        refresh_action = g_simple_action_new("refresh", nullptr);
         glib::connect_signal<GVariant*>(refresh_action, "activate", [this](GSimpleAction*, GVariant*) {
             refresh(true);
         });
-        g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(refresh_action));
         {
 #ifdef __APPLE__
             const char* accels[] = {"<Meta>R", nullptr};
@@ -118,6 +1390,46 @@ public:
             gtk_application_set_accels_for_action(GTK_APPLICATION(app), "app.refresh", accels);
         }
 
+        // The header buttons activate these too, so scripts and keybindings can drive
+        // a running window in one D-Bus call, for example:
+        // gdbus call --session --dest org.telewindow.Tenebra --object-path /org/telewindow/Tenebra --method org.gtk.Actions.Activate restart [] {}
+        start_action = g_simple_action_new("start", nullptr);
+        glib::connect_signal<GVariant*>(start_action, "activate", [this](GSimpleAction*, GVariant*) {
+            start();
+        });
+
+        stop_action = g_simple_action_new("stop", nullptr);
+        glib::connect_signal<GVariant*>(stop_action, "activate", [this](GSimpleAction*, GVariant*) {
+            stop();
+#ifdef __linux__
+            // Otherwise connections would queue with nothing to accept them
+            close_listen_socket();
+#endif
+        });
+
+        restart_action = g_simple_action_new("restart", nullptr);
+        glib::connect_signal<GVariant*>(restart_action, "activate", [this](GSimpleAction*, GVariant*) {
+            restart();
+        });
+
+        // Takes whether the link should be view-only
+        share_action = g_simple_action_new("share", G_VARIANT_TYPE_BOOLEAN);
+        glib::connect_signal<GVariant*>(share_action, "activate", [this](GSimpleAction*, GVariant* parameter) {
+            copy_link(get_share_address(), g_variant_get_boolean(parameter));
+        });
+
+        // Takes the profile's name. The state is the profile config.toml matches, so
+        // that the menu checks it
+        profile_action = g_simple_action_new_stateful("profile", G_VARIANT_TYPE_STRING, g_variant_new_string(""));
+        glib::connect_signal<GVariant*>(profile_action, "activate", [this](GSimpleAction*, GVariant* parameter) {
+            switch_profile(g_variant_get_string(parameter, nullptr));
+        });
+
+        save_profile_action = g_simple_action_new("save-profile", nullptr);
+        glib::connect_signal<GVariant*>(save_profile_action, "activate", [this](GSimpleAction*, GVariant*) {
+            show_save_profile_dialog();
+        });
+
         // The header goes inside an AdwToolbarView rather than being the window's
         // titlebar, so it sits flush with the content and only grows a shadow once
         // something is scrolled under it. Its default style is ADW_TOOLBAR_FLAT
@@ -133,48 +1445,51 @@ public:
 
         start_button = gtk_button_new_with_label("Start");
         gtk_widget_add_css_class(start_button, "suggested-action");
-        glib::connect_signal(start_button, "clicked", [this](GtkWidget*) {
-            if (!start()) {
-                gtk_stack_set_visible_child(GTK_STACK(button_stack), running_box);
-            }
-        });
+        gtk_actionable_set_action_name(GTK_ACTIONABLE(start_button), "app.start");
         gtk_stack_add_child(GTK_STACK(button_stack), start_button);
 
+        starting_button = gtk_button_new_with_label("Starting…");
+        gtk_widget_set_sensitive(starting_button, FALSE);
+        gtk_stack_add_child(GTK_STACK(button_stack), starting_button);
+
         running_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
         gtk_widget_add_css_class(running_box, "linked");
         gtk_stack_add_child(GTK_STACK(button_stack), running_box);
 
-        GtkWidget* stop_button = gtk_button_new_with_label("Stop");
+        stop_button = gtk_button_new_with_label("Stop");
         gtk_widget_add_css_class(stop_button, "destructive-action");
-        glib::connect_signal(stop_button, "clicked", [this](GtkWidget*) {
-            if (!stop()) {
-                gtk_stack_set_visible_child(GTK_STACK(button_stack), start_button);
-            }
-        });
+        gtk_actionable_set_action_name(GTK_ACTIONABLE(stop_button), "app.stop");
         gtk_box_append(GTK_BOX(running_box), stop_button);
 
         GtkWidget* restart_button = gtk_button_new_with_label("Restart");
-        glib::connect_signal(restart_button, "clicked", [this](GtkWidget*) {
-            if (!stop(false) && !start()) {
-                show_toast("Tenebra has been restarted");
-            }
-        });
+        gtk_actionable_set_action_name(GTK_ACTIONABLE(restart_button), "app.restart");
         gtk_box_append(GTK_BOX(running_box), restart_button);
 
         save_button = gtk_button_new_from_icon_name("document-save-symbolic");
         gtk_widget_set_tooltip_text(save_button, "Save");
+        gtk_widget_set_sensitive(save_button, FALSE); // Until the settings have loaded
         glib::connect_signal(save_button, "clicked", [this](GtkWidget*) {
             save(false);
         });
         adw_header_bar_pack_start(ADW_HEADER_BAR(header_bar), save_button);
 
-        GtkWidget* refresh_button = gtk_button_new_from_icon_name("view-refresh-symbolic");
+        refresh_button = gtk_button_new_from_icon_name("view-refresh-symbolic");
         gtk_widget_set_tooltip_text(refresh_button, "Refresh");
+        gtk_widget_set_sensitive(refresh_button, FALSE);
         glib::connect_signal(refresh_button, "clicked", [this](GtkWidget*) {
             refresh(true);
         });
         adw_header_bar_pack_end(ADW_HEADER_BAR(header_bar), refresh_button);
 
+#ifndef _WIN32
+        GtkWidget* logs_button = gtk_button_new_from_icon_name("format-justify-left-symbolic");
+        gtk_widget_set_tooltip_text(logs_button, "Logs");
+        glib::connect_signal(logs_button, "clicked", [this](GtkWidget*) {
+            show_logs();
+        });
+        adw_header_bar_pack_end(ADW_HEADER_BAR(header_bar), logs_button);
+#endif
+
         GtkWidget* share_popover = gtk_popover_new();
 
         GtkWidget* share_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 24);
@@ -192,48 +1507,19 @@ public:
         // Don't set max-width-chars here: it sets the natural width, not a cap
         gtk_editable_set_width_chars(GTK_EDITABLE(address_entry), 24);
         glib::connect_signal(address_entry, "map", [this, address_entry](GtkWidget*) {
-            gtk_editable_set_text(GTK_EDITABLE(address_entry), (get_common_name_from_cert(gtk_editable_get_text(GTK_EDITABLE(cert_entry))) + ':' + std::to_string((unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(port_entry)))).c_str());
+            gtk_editable_set_text(GTK_EDITABLE(address_entry), get_share_address().c_str());
         });
         gtk_box_append(GTK_BOX(share_box), address_entry);
 
         GtkWidget* view_only_check_button = gtk_check_button_new_with_label("View only");
         gtk_box_append(GTK_BOX(share_box), view_only_check_button);
 
-        GtkWidget* copy_link_button = gtk_button_new_with_label("Copy One-Time Link");
-        gtk_widget_add_css_class(copy_link_button, "suggested-action");
-        glib::connect_signal(copy_link_button, "clicked", [this, address_entry, view_only_check_button](GtkWidget* copy_link_button) {
-            json req_json = {
-                {"password", gtk_editable_get_text(GTK_EDITABLE(password_entry))},
-                {"view_only", (bool) gtk_check_button_get_active(GTK_CHECK_BUTTON(view_only_check_button))},
-            };
-
-            pn::TLSContext tls_context;
-            if (pn::Status result = tls_context.init_client(SSL_VERIFY_NONE); !result) {
-                show_toast("Failed to create one-time link key: " + result.error().message());
-                return;
-            }
-
-            pw::Response resp;
-            if (pn::Status result = pw::fetch("POST", "https://127.0.0.1:" + std::to_string((unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(port_entry))) + "/create_key", resp, req_json.dump(), {{"Content-Type", "application/json"}}, {.tls_context = &tls_context}); !result) {
-                show_toast("Failed to create one-time link key: " + result.error().message());
-                return;
-            } else if (resp.status_code != 200) {
-                show_toast("Failed to create one-time link key: Response has status code " + std::to_string(resp.status_code));
-                return;
-            }
-
-            pw::URLInfo url_info;
-            url_info.scheme = "https";
-            url_info.host = "audacia.duckdns.org";
-            *url_info.query_parameters = {
-                {"address", gtk_editable_get_text(GTK_EDITABLE(address_entry))},
-                {"key", resp.body_string()},
-                {"view_only", gtk_check_button_get_active(GTK_CHECK_BUTTON(view_only_check_button)) ? "true" : "false"},
-            };
-            gdk_clipboard_set_text(gdk_display_get_clipboard(gtk_widget_get_display(copy_link_button)), url_info.build().c_str());
-
-            show_toast("Copied one-time access link to clipboard");
-            gtk_menu_button_popdown(GTK_MENU_BUTTON(share_button));
+        GtkWidget* copy_link_button = gtk_button_new_with_label("Copy One-Time Link");
+        gtk_widget_add_css_class(copy_link_button, "suggested-action");
+        glib::connect_signal(copy_link_button, "clicked", [this, address_entry, view_only_check_button](GtkWidget*) {
+            if (!copy_link(gtk_editable_get_text(GTK_EDITABLE(address_entry)), gtk_check_button_get_active(GTK_CHECK_BUTTON(view_only_check_button)))) {
+                gtk_menu_button_popdown(GTK_MENU_BUTTON(share_button));
+            }
         });
         gtk_box_append(GTK_BOX(share_box), copy_link_button);
 
@@ -245,9 +1531,27 @@ public:
         // glyph in Adwaita but two people in Breeze
         gtk_menu_button_set_icon_name(GTK_MENU_BUTTON(share_button), "send-to-symbolic");
         gtk_widget_set_tooltip_text(share_button, "Share");
+        gtk_widget_set_sensitive(share_button, FALSE);
         gtk_menu_button_set_popover(GTK_MENU_BUTTON(share_button), share_popover);
         adw_header_bar_pack_end(ADW_HEADER_BAR(header_bar), share_button);
 
+        profile_menu = g_menu_new();
+        glib::Object<GMenu> profile_button_menu = g_menu_new();
+        g_menu_append_section(profile_button_menu.get(), nullptr, G_MENU_MODEL(profile_menu));
+        g_object_unref(profile_menu); // Now owned by profile_button_menu
+        {
+            glib::Object<GMenu> section = g_menu_new();
+            g_menu_append(section.get(), "Save as Profile…", "app.save-profile");
+            g_menu_append_section(profile_button_menu.get(), nullptr, G_MENU_MODEL(section.get()));
+        }
+
+        profile_button = gtk_menu_button_new();
+        gtk_menu_button_set_label(GTK_MENU_BUTTON(profile_button), "Profiles");
+        gtk_widget_set_tooltip_text(profile_button, "Profiles");
+        gtk_widget_set_sensitive(profile_button, FALSE);
+        gtk_menu_button_set_menu_model(GTK_MENU_BUTTON(profile_button), G_MENU_MODEL(profile_button_menu.get()));
+        adw_header_bar_pack_end(ADW_HEADER_BAR(header_bar), profile_button);
+
         toast_overlay = adw_toast_overlay_new();
         adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(toolbar_view), toast_overlay);
 
@@ -264,113 +1568,48 @@ public:
 
         // Groups appear in the order they are added to the page, so rows below may be
         // created in whatever order their signal handlers require
-        AdwPreferencesGroup* connection_group = add_group("Connection");
-        AdwPreferencesGroup* capture_group = add_group("Screen Capture");
-        AdwPreferencesGroup* video_group = add_group("Video Encoding");
-        AdwPreferencesGroup* audio_group = add_group("Audio");
-        AdwPreferencesGroup* network_group = add_group("Network");
-        AdwPreferencesGroup* security_group = add_group("Security");
+#ifdef __linux__
+        instances_group = GTK_WIDGET(add_group("Instances"));
+        adw_preferences_group_set_description(ADW_PREFERENCES_GROUP(instances_group), "Choose which instance's settings to edit");
+
+        GtkWidget* new_instance_button = gtk_button_new_from_icon_name("list-add-symbolic");
+        gtk_widget_set_tooltip_text(new_instance_button, "New Instance");
+        gtk_widget_set_valign(new_instance_button, GTK_ALIGN_CENTER);
+        gtk_widget_add_css_class(new_instance_button, "flat");
+        glib::connect_signal(new_instance_button, "clicked", [this](GtkWidget*) {
+            show_new_instance_dialog();
+        });
+        adw_preferences_group_set_header_suffix(ADW_PREFERENCES_GROUP(instances_group), new_instance_button);
+#endif
+        setting_groups[(size_t) SettingGroup::Connection] = add_group("Connection");
+        setting_groups[(size_t) SettingGroup::Capture] = add_group("Screen Capture");
+        setting_groups[(size_t) SettingGroup::Video] = add_group("Video Encoding");
+        setting_groups[(size_t) SettingGroup::Audio] = add_group("Audio");
+        setting_groups[(size_t) SettingGroup::Network] = add_group("Network");
+#ifndef _WIN32
+        AdwPreferencesGroup* process_group = setting_groups[(size_t) SettingGroup::Process] = add_group("Process");
+#endif
+#ifdef __linux__
+        AdwPreferencesGroup* scheduling_group = setting_groups[(size_t) SettingGroup::Scheduling] = add_group("Scheduling");
+        adw_preferences_group_set_description(scheduling_group, "Applied when Tenebra is started, to keep it from competing with other workloads");
+#endif
+        AdwPreferencesGroup* security_group = setting_groups[(size_t) SettingGroup::Security] = add_group("Security");
         adw_preferences_group_set_description(security_group, "Both files must be PEM-encoded, and the certificate should include any intermediates");
-
-        password_entry = adw_password_entry_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(password_entry), "Password");
-        glib::connect_signal<GParamSpec*>(password_entry, "notify::text", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(connection_group, password_entry);
-
-        port_entry = adw_spin_row_new_with_range(0., 65535., 1.);
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(port_entry), "Port");
-        adw_spin_row_set_value(ADW_SPIN_ROW(port_entry), 8080);
-        glib::connect_signal<GParamSpec*>(port_entry, "notify::value", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(connection_group, port_entry);
-
-        target_bitrate_entry = adw_spin_row_new_with_range(50., 12000., 1.);
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(target_bitrate_entry), "Target Bitrate (kbps)");
-        adw_spin_row_set_value(ADW_SPIN_ROW(target_bitrate_entry), 4000);
-        glib::connect_signal<GParamSpec*>(target_bitrate_entry, "notify::value", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(video_group, target_bitrate_entry);
-
-        windows_monitor_index_entry = adw_spin_row_new_with_range(-1., 65535., 1.);
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(windows_monitor_index_entry), "Monitor Index");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(windows_monitor_index_entry), "The index of the monitor to capture (-1 = primary monitor)");
-        adw_spin_row_set_value(ADW_SPIN_ROW(windows_monitor_index_entry), -1.);
-        glib::connect_signal<GParamSpec*>(windows_monitor_index_entry, "notify::value", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(capture_group, windows_monitor_index_entry);
-
-        windows_capture_api_combo_box = adw_combo_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(windows_capture_api_combo_box), "Screen Capture API");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(windows_capture_api_combo_box), "The API to use for screen capture (DXGI is more compatible, but WGC is newer and more modern)");
-        const char* capture_apis[] = {"DXGI", "WGC", nullptr};
-        adw_combo_row_set_model(ADW_COMBO_ROW(windows_capture_api_combo_box), G_LIST_MODEL(gtk_string_list_new(capture_apis)));
-        adw_combo_row_set_selected(ADW_COMBO_ROW(windows_capture_api_combo_box), 0);
-        glib::connect_signal<GParamSpec*>(windows_capture_api_combo_box, "notify::selected", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(capture_group, windows_capture_api_combo_box);
-
-        startx_entry = adw_spin_row_new_with_range(0., 65535., 1.);
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(startx_entry), "Start X");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(startx_entry), "The x-coordinate to start streaming at");
-        glib::connect_signal<GParamSpec*>(startx_entry, "notify::value", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(capture_group, startx_entry);
-
-        starty_entry = adw_spin_row_new_with_range(0., 65535., 1.);
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(starty_entry), "Start Y");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(starty_entry), "The y-coordinate to start streaming at");
-        glib::connect_signal<GParamSpec*>(starty_entry, "notify::value", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(capture_group, starty_entry);
-
-        endx_entry = adw_spin_row_new_with_range(0., 65535., 1.);
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(endx_entry), "End X");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(endx_entry), "The x-coordinate to stop streaming at");
-        glib::connect_signal<GParamSpec*>(endx_entry, "notify::value", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(capture_group, endx_entry);
-
-        endx_check_button = gtk_check_button_new();
-        gtk_widget_set_valign(endx_check_button, GTK_ALIGN_CENTER);
-        glib::connect_signal<GParamSpec*>(endx_check_button, "notify::active", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_action_row_add_prefix(ADW_ACTION_ROW(endx_entry), endx_check_button);
-
-        endy_entry = adw_spin_row_new_with_range(0., 65535., 1.);
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(endy_entry), "End Y");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(endy_entry), "The y-coordinate to stop streaming at");
-        glib::connect_signal<GParamSpec*>(endy_entry, "notify::value", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(capture_group, endy_entry);
-
-        endy_check_button = gtk_check_button_new();
-        gtk_widget_set_valign(endy_check_button, GTK_ALIGN_CENTER);
-        glib::connect_signal<GParamSpec*>(endy_check_button, "notify::active", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_action_row_add_prefix(ADW_ACTION_ROW(endy_entry), endy_check_button);
-
-        vbv_buf_capacity_entry = adw_spin_row_new_with_range(1., 1000., 1.);
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(vbv_buf_capacity_entry), "VBV Buffer Capacity (ms)");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(vbv_buf_capacity_entry), "The size of the video buffering verifier (VBV) buffer, which controls how smoothly bitrate is distributed to prevent playback stuttering or quality drops");
-        adw_spin_row_set_value(ADW_SPIN_ROW(vbv_buf_capacity_entry), 120);
-        glib::connect_signal<GParamSpec*>(vbv_buf_capacity_entry, "notify::value", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(video_group, vbv_buf_capacity_entry);
-
-        tcp_upnp_switch = adw_switch_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(tcp_upnp_switch), "Automatic ICE-TCP UPnP Forwarding");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(tcp_upnp_switch), "Automatically forwards TCP ports for ICE-TCP");
-        adw_switch_row_set_active(ADW_SWITCH_ROW(tcp_upnp_switch), TRUE);
-        glib::connect_signal<GParamSpec*>(tcp_upnp_switch, "notify::active", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(network_group, tcp_upnp_switch);
-
-        sound_forwarding_switch = adw_switch_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(sound_forwarding_switch), "Sound Forwarding");
-#ifndef __APPLE__
-        adw_switch_row_set_active(ADW_SWITCH_ROW(sound_forwarding_switch), TRUE);
-#endif
-        glib::connect_signal<GParamSpec*>(sound_forwarding_switch, "notify::active", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(audio_group, sound_forwarding_switch);
-
-        hwencode_switch = adw_switch_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(hwencode_switch), "Hardware-Accelerated Video Encoding");
-#ifdef _WIN32
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(hwencode_switch), "Uses Microsoft Media Foundation for video encoding and conversion");
-#elif defined(__APPLE__)
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(hwencode_switch), "Uses Apple VideoToolbox for video encoding and conversion");
-#else
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(hwencode_switch), "Uses VA-API on devices with Intel or AMD GPUs");
+#ifdef __linux__
+        performance_group = GTK_WIDGET(add_group("Performance"));
+        adw_preferences_group_set_description(ADW_PREFERENCES_GROUP(performance_group), "Resource usage of the running Tenebra process");
+        gtk_widget_set_visible(performance_group, FALSE); // Until there's a process to monitor
+#endif
+#ifndef _WIN32
+        stream_group = GTK_WIDGET(add_group("Stream"));
+        adw_preferences_group_set_description(ADW_PREFERENCES_GROUP(stream_group), "Read from Tenebra's log output");
+        gtk_widget_set_visible(stream_group, FALSE); // Until a line matches
 #endif
-        glib::connect_signal<GParamSpec*>(hwencode_switch, "notify::active", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
+
+        for (SettingGroup group : {SettingGroup::Connection, SettingGroup::Video, SettingGroup::Audio, SettingGroup::Network, SettingGroup::Process, SettingGroup::Scheduling}) {
+            add_setting_rows(group);
+        }
+
         glib::connect_signal<GParamSpec*>(hwencode_switch, "notify::active", [this](GtkWidget* hwencode_switch, GParamSpec*) {
             if (adw_switch_row_get_active(ADW_SWITCH_ROW(hwencode_switch))) {
 #ifdef _WIN32
@@ -397,101 +1636,153 @@ public:
                 gtk_widget_set_sensitive(color_downsampling_switch, TRUE);
             }
         });
-        adw_preferences_group_add(video_group, hwencode_switch);
-
-        // Created after hwencode_switch so that it lands directly beneath the toggle that
-        // controls its sensitivity. Safe because nothing activates that toggle until
-        // refresh() runs, by which point every row exists
-        windows_quality_vs_speed_row = adw_action_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(windows_quality_vs_speed_row), "Quality vs. Speed");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(windows_quality_vs_speed_row), "0 = high speed and low quality, 100 = high quality and low speed");
         gtk_widget_set_sensitive(windows_quality_vs_speed_row, FALSE);
-        adw_preferences_group_add(video_group, windows_quality_vs_speed_row);
-
-        windows_quality_vs_speed_scale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0., 100., 1.);
-        gtk_range_set_value(GTK_RANGE(windows_quality_vs_speed_scale), 50.);
-        gtk_scale_add_mark(GTK_SCALE(windows_quality_vs_speed_scale), 50., GTK_POS_BOTTOM, nullptr);
-        gtk_scale_set_draw_value(GTK_SCALE(windows_quality_vs_speed_scale), TRUE);
-        gtk_widget_set_size_request(windows_quality_vs_speed_scale, 150, -1);
-        glib::connect_signal<GParamSpec*>(gtk_range_get_adjustment(GTK_RANGE(windows_quality_vs_speed_scale)), "notify::value", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_action_row_add_suffix(ADW_ACTION_ROW(windows_quality_vs_speed_row), windows_quality_vs_speed_scale);
-
-        vapostproc_switch = adw_switch_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(vapostproc_switch), "VA-API Video Conversion");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(vapostproc_switch), "Enables hardware-accelerated video format conversion on devices with Intel or AMD GPUs");
         gtk_widget_set_sensitive(vapostproc_switch, FALSE);
-        glib::connect_signal<GParamSpec*>(vapostproc_switch, "notify::active", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(video_group, vapostproc_switch);
-
-        color_downsampling_switch = adw_switch_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(color_downsampling_switch), "Color Channel Downsampling");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(color_downsampling_switch), "Encodes frames in NV12 format");
-        adw_switch_row_set_active(ADW_SWITCH_ROW(color_downsampling_switch), TRUE);
-        glib::connect_signal<GParamSpec*>(color_downsampling_switch, "notify::active", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(video_group, color_downsampling_switch);
-
-        bwe_switch = adw_switch_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(bwe_switch), "Bandwidth Estimation");
-        adw_action_row_set_subtitle(ADW_ACTION_ROW(bwe_switch), "Adjusts media bitrate on the fly to adapt to changing network conditions");
-        adw_switch_row_set_active(ADW_SWITCH_ROW(bwe_switch), TRUE);
-        glib::connect_signal<GParamSpec*>(bwe_switch, "notify::active", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(network_group, bwe_switch);
-
-        cert_entry = adw_entry_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(cert_entry), "TLS Certificate");
-        glib::connect_signal<GParamSpec*>(cert_entry, "notify::text", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(security_group, cert_entry);
-
-        GtkWidget* choose_cert_button = gtk_button_new_from_icon_name("document-open-symbolic");
-        gtk_widget_set_tooltip_text(choose_cert_button, "Choose File");
-        gtk_widget_set_valign(choose_cert_button, GTK_ALIGN_CENTER);
-        gtk_widget_add_css_class(choose_cert_button, "flat");
-        glib::connect_signal(choose_cert_button, "clicked", std::bind(&MainWindow::handle_choose_file, this, std::placeholders::_1, cert_entry));
-        adw_entry_row_add_suffix(ADW_ENTRY_ROW(cert_entry), choose_cert_button);
-
-        key_entry = adw_entry_row_new();
-        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(key_entry), "Private Key");
-        glib::connect_signal<GParamSpec*>(key_entry, "notify::text", std::bind(&MainWindow::handle_change, this, std::placeholders::_1, std::placeholders::_2));
-        adw_preferences_group_add(security_group, key_entry);
-
-        GtkWidget* choose_key_button = gtk_button_new_from_icon_name("document-open-symbolic");
-        gtk_widget_set_tooltip_text(choose_key_button, "Choose File");
-        gtk_widget_set_valign(choose_key_button, GTK_ALIGN_CENTER);
-        gtk_widget_add_css_class(choose_key_button, "flat");
-        glib::connect_signal(choose_key_button, "clicked", std::bind(&MainWindow::handle_choose_file, this, std::placeholders::_1, key_entry));
-        adw_entry_row_add_suffix(ADW_ENTRY_ROW(key_entry), choose_key_button);
 
+#ifndef _WIN32
+        adw_action_row_set_subtitle(ADW_ACTION_ROW(save_log_switch), ("Also writes Tenebra's output to " + (get_config_path(instance) / "tenebra.log").string() + ", rotated at 1 MiB").c_str());
+
+        glib::connect_signal<GParamSpec*>(restart_on_crash_switch, "notify::active", [this](GtkWidget* restart_on_crash_switch, GParamSpec*) {
+            if (!adw_switch_row_get_active(ADW_SWITCH_ROW(restart_on_crash_switch))) {
+                cancel_restart();
+            }
+        });
+
+        recovery_time_row = adw_action_row_new();
+        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(recovery_time_row), "Recovery Time");
+        gtk_widget_add_css_class(recovery_time_row, "property");
+        gtk_widget_set_tooltip_text(recovery_time_row, "Downtime from a crash until the restarted Tenebra accepts connections");
+        adw_preferences_group_add(process_group, recovery_time_row);
+        update_recovery_time_row();
+
+        launch_history_row = adw_expander_row_new();
+        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(launch_history_row), "Launch History");
+        adw_preferences_group_add(process_group, launch_history_row);
+        update_launch_history();
+#endif
+
+#ifdef __linux__
+        glib::connect_signal<GParamSpec*>(cpu_affinity_entry, "notify::text", [](GtkWidget* cpu_affinity_entry, GParamSpec*) {
+            std::string cpu_list = gtk_editable_get_text(GTK_EDITABLE(cpu_affinity_entry));
+            cpu_set_t cpu_set;
+            if (cpu_list.empty() || parse_cpu_list(cpu_list, cpu_set)) {
+                gtk_widget_remove_css_class(cpu_affinity_entry, "error");
+            } else {
+                gtk_widget_add_css_class(cpu_affinity_entry, "error");
+            }
+        });
+#endif
+
+#ifdef __linux__
+        // The "property" style emphasizes the subtitle, which is where the readings go
+        auto add_performance_row = [this](const char* title, Sparkline* sparkline = nullptr) {
+            GtkWidget* row = adw_action_row_new();
+            adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row), title);
+            gtk_widget_add_css_class(row, "property");
+            if (sparkline) {
+                adw_action_row_add_suffix(ADW_ACTION_ROW(row), sparkline->get());
+            }
+            adw_preferences_group_add(ADW_PREFERENCES_GROUP(performance_group), row);
+            return row;
+        };
+
+        cpu_sparkline = Sparkline(60, 100.);
+        cpu_row = add_performance_row("CPU Usage", &cpu_sparkline);
+
+        memory_sparkline = Sparkline(60);
+        memory_row = add_performance_row("Resident Memory", &memory_sparkline);
+
+        // Expands into per-thread usage, grouped by thread name
+        threads_row = adw_expander_row_new();
+        adw_preferences_row_set_title(ADW_PREFERENCES_ROW(threads_row), "Threads");
+        adw_preferences_row_set_use_markup(ADW_PREFERENCES_ROW(threads_row), FALSE);
+        adw_preferences_group_add(ADW_PREFERENCES_GROUP(performance_group), threads_row);
+
+        context_switches_sparkline = Sparkline(60);
+        context_switches_row = add_performance_row("Context Switches", &context_switches_sparkline);
+
+        io_sparkline = Sparkline(60);
+        io_row = add_performance_row("Disk I/O", &io_sparkline);
+
+        startup_time_sparkline = Sparkline(50);
+        startup_time_row = add_performance_row("Time to Serve", &startup_time_sparkline);
+        gtk_widget_set_tooltip_text(startup_time_row, "Time from launching Tenebra to it accepting connections");
+#endif
+#ifndef _WIN32
+        for (size_t i = 0; i < metric_count; ++i) {
+            metric_sparklines[i] = Sparkline(60);
+            metric_rows[i] = adw_action_row_new();
+            adw_preferences_row_set_title(ADW_PREFERENCES_ROW(metric_rows[i]), metric_rules[i].title);
+            gtk_widget_add_css_class(metric_rows[i], "property");
+            adw_action_row_add_suffix(ADW_ACTION_ROW(metric_rows[i]), metric_sparklines[i].get());
+            gtk_widget_set_visible(metric_rows[i], FALSE); // Until a line matches its rule
+            adw_preferences_group_add(ADW_PREFERENCES_GROUP(stream_group), metric_rows[i]);
+        }
+#endif
 #ifdef _WIN32
         gtk_widget_set_visible(vapostproc_switch, FALSE);
 #elif defined(__APPLE__)
-        gtk_widget_set_visible(windows_monitor_index_entry, FALSE);
-        gtk_widget_set_visible(windows_capture_api_combo_box, FALSE);
         gtk_widget_set_visible(windows_quality_vs_speed_row, FALSE);
         gtk_widget_set_visible(sound_forwarding_switch, FALSE);
-        gtk_widget_set_visible(GTK_WIDGET(audio_group), FALSE); // Otherwise its title would sit above nothing
+        gtk_widget_set_visible(GTK_WIDGET(setting_groups[(size_t) SettingGroup::Audio]), FALSE); // Otherwise its title would sit above nothing
         gtk_widget_set_visible(vapostproc_switch, FALSE);
 #else
-        gtk_widget_set_visible(windows_monitor_index_entry, FALSE);
-        gtk_widget_set_visible(windows_capture_api_combo_box, FALSE);
         gtk_widget_set_visible(windows_quality_vs_speed_row, FALSE);
 #endif
 
-        refresh();
-        g_timeout_add(2000, [](void* data) -> gboolean {
-            auto tenebra = (MainWindow*) data;
-            if (gtk_widget_is_visible(tenebra->window)) {
-                if (get_tenebra_pid() == -1) {
-                    gtk_stack_set_visible_child(GTK_STACK(tenebra->button_stack), tenebra->start_button);
-                } else {
-                    gtk_stack_set_visible_child(GTK_STACK(tenebra->button_stack), tenebra->running_box);
+#ifdef __linux__
+        // Lets instances launched by systemd or a script show up as soon as they exec.
+        // Without CAP_NET_ADMIN this fails, and set_tenebra_pid() falls back to
+        // rescanning while Tenebra is stopped
+        if ((proc_events_fd = open_proc_events()) != -1) {
+            g_unix_fd_add(proc_events_fd, G_IO_IN, [](int fd, GIOCondition, void* data) -> gboolean {
+                auto tenebra = (MainWindow*) data;
+                ProcEvent event;
+                bool rescan = false; // For the instances that aren't being edited
+                while (read_proc_event(fd, event) != -1) {
+                    if (event.type == ProcEventType::Exec) {
+                        // Checked off the main thread, since a busy system execs thousands
+                        // of times a second and each check reads procfs
+                        if ((tenebra->tenebra_pid == -1 || tenebra->instances.size() > 1) && event.pid != tenebra->tenebra_pid) {
+                            if (tenebra->exec_pids.size() < 4096) {
+                                tenebra->exec_pids.push_back(event.pid);
+                            } else {
+                                rescan = true; // Too many to check one by one
+                            }
+                        }
+                    } else if (event.pid == tenebra->tenebra_pid) {
+                        tenebra->set_tenebra_pid(-1);
+                    } else if (std::find(tenebra->instance_pids.begin(), tenebra->instance_pids.end(), event.pid) != tenebra->instance_pids.end()) {
+                        rescan = true;
+                    }
+                }
+                if (errno == ENOBUFS || rescan) {
+                    tenebra->refresh_tenebra_pid(); // Either events were dropped, or another instance changed
                 }
+                tenebra->check_exec_pids();
+                return G_SOURCE_CONTINUE;
+            },
+                this);
+        }
+#endif
+
+        // Already off the main thread, so it can overlap with building the window
+        refresh_tenebra_pid();
+
+        // Someone coming back to the window likely wants to see what they started
+        // elsewhere, so a backed-off poll catches up at once
+        glib::connect_signal<GParamSpec*>(window, "notify::is-active", [this](GtkWidget* window, GParamSpec*) {
+            if (gtk_window_is_active(GTK_WINDOW(window)) && tenebra_poll_source && tenebra_poll_interval != 2000) {
+                g_source_remove(tenebra_poll_source);
+                tenebra_poll_source = 0;
+                tenebra_poll_interval = 2000;
+                refresh_tenebra_pid();
+                poll_tenebra_pid();
             }
-            return TRUE;
-        },
-            this);
+        });
 
         glib::connect_signal(window, "close-request", [this](GtkWidget* window) -> gboolean {
-            if (dirty) {
+            if (dirty && loaded) {
                 AdwDialog* dialog = adw_alert_dialog_new("Save Changes?", "You have unsaved changes. Changes that are not saved will be permanently lost.");
                 adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(dialog), "cancel", "Cancel", "discard", "Discard", "save", "Save", nullptr);
                 adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog), "discard", ADW_RESPONSE_DESTRUCTIVE);
@@ -514,17 +1805,182 @@ public:
         });
 
         gtk_window_present(GTK_WINDOW(window));
-        if (new_user) {
-            AdwDialog* dialog = adw_alert_dialog_new("Welcome!", "Welcome to Tenebra! Here, you can configure Tenebra's settings. Before starting, make sure you’ve set a password and directed it to your TLS certificate.");
-            adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(dialog), "thanks", "Thanks!", nullptr);
-            adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog), "thanks", ADW_RESPONSE_SUGGESTED);
-            adw_alert_dialog_set_default_response(ADW_ALERT_DIALOG(dialog), "thanks");
-            adw_dialog_present(dialog, window);
+
+        // Everything else waits until the window has been drawn once. The handler
+        // only disconnects itself, so the rest runs from an idle rather than in the
+        // middle of the frame
+        first_frame_handler = glib::connect_signal(gtk_widget_get_frame_clock(window), "after-paint", [this](GdkFrameClock* frame_clock) {
+            g_signal_handler_disconnect(frame_clock, first_frame_handler);
+            g_debug("First frame drawn %.1f ms after process start", get_time_since_process_start());
+            g_idle_add([](void* data) -> gboolean {
+                ((MainWindow*) data)->finish_activate();
+                return G_SOURCE_REMOVE;
+            },
+                this);
+        });
+    }
+
+    void finish_activate() {
+        build_capture_rows();
+        build_security_rows();
+        load_startup_times();
+
+        load_config([this]() {
+            loaded = true;
+            if (new_user) applied_settings = get_settings(); // Defaults aren't edits
+            watch_config();
+            g_debug("Settings loaded %.1f ms after process start", get_time_since_process_start());
+
+            GtkApplication* app = gtk_window_get_application(GTK_WINDOW(window));
+            for (GSimpleAction* action : {save_action, refresh_action, start_action, stop_action, restart_action, share_action, profile_action, save_profile_action}) {
+                g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(action));
+            }
+            gtk_widget_set_sensitive(save_button, dirty);
+            gtk_widget_set_sensitive(refresh_button, TRUE);
+            gtk_widget_set_sensitive(share_button, TRUE);
+            gtk_widget_set_sensitive(profile_button, TRUE);
+
+            if (new_user) {
+                AdwDialog* dialog = adw_alert_dialog_new("Welcome!", "Welcome to Tenebra! Here, you can configure Tenebra's settings. Before starting, make sure you’ve set a password and directed it to your TLS certificate.");
+                adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(dialog), "thanks", "Thanks!", nullptr);
+                adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog), "thanks", ADW_RESPONSE_SUGGESTED);
+                adw_alert_dialog_set_default_response(ADW_ALERT_DIALOG(dialog), "thanks");
+                adw_dialog_present(dialog, window);
+            }
+        });
+    }
+
+    void build_capture_rows() {
+        add_setting_rows(SettingGroup::Capture);
+#ifndef _WIN32
+        gtk_widget_set_visible(windows_monitor_index_entry, FALSE);
+        gtk_widget_set_visible(windows_capture_api_combo_box, FALSE);
+#endif
+    }
+
+    void build_security_rows() {
+        add_setting_rows(SettingGroup::Security);
+        for (GtkWidget* entry : {cert_entry, key_entry}) {
+            GtkWidget* choose_button = gtk_button_new_from_icon_name("document-open-symbolic");
+            gtk_widget_set_tooltip_text(choose_button, "Choose File");
+            gtk_widget_set_valign(choose_button, GTK_ALIGN_CENTER);
+            gtk_widget_add_css_class(choose_button, "flat");
+            glib::connect_signal(choose_button, "clicked", std::bind(&MainWindow::handle_choose_file, this, std::placeholders::_1, entry));
+            adw_entry_row_add_suffix(ADW_ENTRY_ROW(entry), choose_button);
+        }
+    }
+
+    // Builds the rows for a group's settings, in setting_schema order, and leaves
+    // them at their defaults
+    void add_setting_rows(SettingGroup group) {
+        for (size_t i = 0; i < setting_count; ++i) {
+            const SettingSchema& setting = setting_schema[i];
+            if (setting.group != group || !(setting.platforms & platform_current)) continue;
+
+            GtkWidget* row;
+            GtkWidget* widget;
+            GObject* notifier; // Whichever object's property holds the value
+            const char* signal;
+            switch (setting.widget) {
+            case SettingWidget::Entry:
+            case SettingWidget::PasswordEntry:
+                row = widget = setting.widget == SettingWidget::Entry ? adw_entry_row_new() : adw_password_entry_row_new();
+                if (setting.description) gtk_widget_set_tooltip_text(row, setting.description); // Entry rows have no subtitle
+                gtk_editable_set_text(GTK_EDITABLE(widget), std::string(setting.default_string).c_str());
+                notifier = G_OBJECT(widget);
+                signal = "notify::text";
+                break;
+
+            case SettingWidget::SpinRow:
+                row = widget = adw_spin_row_new_with_range(setting.min, setting.max, 1.);
+                adw_spin_row_set_value(ADW_SPIN_ROW(widget), setting.default_integer);
+                notifier = G_OBJECT(widget);
+                signal = "notify::value";
+                break;
+
+            case SettingWidget::Scale:
+                row = adw_action_row_new();
+                widget = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, setting.min, setting.max, 1.);
+                gtk_range_set_value(GTK_RANGE(widget), setting.default_integer);
+                gtk_scale_add_mark(GTK_SCALE(widget), setting.default_integer, GTK_POS_BOTTOM, nullptr);
+                gtk_scale_set_draw_value(GTK_SCALE(widget), TRUE);
+                gtk_widget_set_size_request(widget, 150, -1);
+                adw_action_row_add_suffix(ADW_ACTION_ROW(row), widget);
+                notifier = G_OBJECT(gtk_range_get_adjustment(GTK_RANGE(widget)));
+                signal = "notify::value";
+                break;
+
+            case SettingWidget::SwitchRow:
+            case SettingWidget::InvertedSwitchRow:
+                row = widget = adw_switch_row_new();
+                adw_switch_row_set_active(ADW_SWITCH_ROW(widget), setting.default_boolean != (setting.widget == SettingWidget::InvertedSwitchRow));
+                notifier = G_OBJECT(widget);
+                signal = "notify::active";
+                break;
+
+            case SettingWidget::ComboRow: {
+                row = widget = adw_combo_row_new();
+                GtkStringList* labels = gtk_string_list_new(nullptr);
+                for (const SettingChoice& choice : setting.choices) {
+                    gtk_string_list_append(labels, choice.label);
+                }
+                adw_combo_row_set_model(ADW_COMBO_ROW(widget), G_LIST_MODEL(labels));
+                adw_combo_row_set_selected(ADW_COMBO_ROW(widget), get_choice_index(setting, setting.default_string));
+                notifier = G_OBJECT(widget);
+                signal = "notify::selected";
+                break;
+            }
+            }
+            adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row), setting.title);
+            if (setting.description && ADW_IS_ACTION_ROW(row)) {
+                adw_action_row_set_subtitle(ADW_ACTION_ROW(row), setting.description);
+            }
+            glib::connect_signal<GParamSpec*>(notifier, signal, [this, i](void*, GParamSpec*) {
+                handle_change(i);
+            });
+
+            if (setting.optional) {
+                setting_check_buttons[i] = gtk_check_button_new();
+                gtk_widget_set_valign(setting_check_buttons[i], GTK_ALIGN_CENTER);
+                glib::connect_signal<GParamSpec*>(setting_check_buttons[i], "notify::active", [this, i](void*, GParamSpec*) {
+                    handle_change(i);
+                });
+                adw_action_row_add_prefix(ADW_ACTION_ROW(row), setting_check_buttons[i]);
+            }
+
+            adw_preferences_group_add(setting_groups[(size_t) group], row);
+            setting_rows[i] = row;
+            setting_widgets[i] = widget;
+        }
+    }
+
+    // Unknown values select the first choice
+    static guint get_choice_index(const SettingSchema& setting, std::string_view value) {
+        for (size_t i = 0; i < setting.choices.size(); ++i) {
+            if (setting.choices[i].value == value) return i;
         }
+        return 0;
+    }
+
+    // Only reads the row that changed, so an edit costs the same however many
+    // settings there are
+    void handle_change(size_t i) {
+        if (applying_settings) return;
+        set_modified(i, get_setting(i) != applied_settings[i]);
     }
 
-    void handle_change(void*, GParamSpec*) {
-        gtk_widget_set_sensitive(save_button, dirty = true);
+    // Modified rows are highlighted, and the save button stays enabled while any
+    // are, or while there's no config.toml to compare against
+    void set_modified(size_t i, bool modified) {
+        if (modified != this->modified[i] && setting_rows[i]) {
+            if (modified) {
+                gtk_widget_add_css_class(setting_rows[i], "accent");
+            } else {
+                gtk_widget_remove_css_class(setting_rows[i], "accent");
+            }
+        }
+        this->modified[i] = modified;
+        gtk_widget_set_sensitive(save_button, dirty = this->modified.any() || !config_saved);
     }
 
     void handle_choose_file(GtkWidget*, GtkWidget* entry) {
@@ -556,12 +2012,7 @@ public:
             glib::connect_signal<char*>(dialog, "response", [this](AdwDialog*, char* response) {
                 if (!strcmp(response, "save")) {
                     save();
-
-                    if (get_tenebra_pid() == -1) {
-                        gtk_stack_set_visible_child(GTK_STACK(button_stack), start_button);
-                    } else {
-                        gtk_stack_set_visible_child(GTK_STACK(button_stack), running_box);
-                    }
+                    refresh_tenebra_pid();
                 } else if (!strcmp(response, "discard")) {
                     refresh();
                 }
@@ -570,240 +2021,660 @@ public:
             return;
         }
 
-        if (get_tenebra_pid() == -1) {
-            gtk_stack_set_visible_child(GTK_STACK(button_stack), start_button);
-        } else {
-            gtk_stack_set_visible_child(GTK_STACK(button_stack), running_box);
-        }
+        refresh_tenebra_pid();
+        load_profiles();
 
-        auto config_path = get_config_path();
+        auto config_path = get_config_path(instance);
         if (!config_path.empty()) {
             if (!std::filesystem::exists(config_path / "config.toml")) {
                 if (!std::filesystem::exists(config_path)) {
-                    std::filesystem::create_directory(config_path);
+                    std::filesystem::create_directories(config_path);
                 }
                 new_user = true;
                 return;
             }
 
             try {
-                auto config = toml::parse(config_path / "config.toml");
-
-                auto password = toml::find<std::string>(config, "password");
-                auto port = toml::find<unsigned short>(config, "port");
-                auto target_bitrate = toml::find<unsigned int>(config, "target_bitrate");
-                auto windows_monitor_index = toml::find_or<int>(config, "windows_monitor_index", -1);
-                auto windows_capture_api = toml::find_or<std::string>(config, "windows_capture_api", "dxgi");
-                auto windows_quality_vs_speed = toml::find_or<unsigned short>(config, "windows_quality_vs_speed", 50);
-                auto startx = toml::find<unsigned short>(config, "startx");
-                auto starty = toml::find_or<unsigned short>(config, "starty", 0);
-                auto vbv_buf_capacity = toml::find_or<unsigned short>(config, "vbv_buf_capacity", 120);
-                auto tcp_upnp = toml::find<bool>(config, "tcp_upnp");
-                auto sound_forwarding = toml::find<bool>(config, "sound_forwarding");
-                auto hwencode = toml::find_or<bool>(config, "hwencode", toml::find_or<bool>(config, "vaapi", false));
-                auto vapostproc = toml::find<bool>(config, "vapostproc");
-                auto full_chroma = toml::find<bool>(config, "full_chroma");
-                auto no_bwe = toml::find<bool>(config, "no_bwe");
-                auto cert = toml::find<std::string>(config, "cert");
-                auto key = toml::find<std::string>(config, "key");
-
-                gtk_editable_set_text(GTK_EDITABLE(password_entry), password.c_str());
-                adw_spin_row_set_value(ADW_SPIN_ROW(port_entry), port);
-                adw_spin_row_set_value(ADW_SPIN_ROW(target_bitrate_entry), target_bitrate);
-                adw_spin_row_set_value(ADW_SPIN_ROW(windows_monitor_index_entry), windows_monitor_index);
-                adw_combo_row_set_selected(ADW_COMBO_ROW(windows_capture_api_combo_box), windows_capture_api == "wgc" ? 1 : 0);
-                gtk_range_set_value(GTK_RANGE(windows_quality_vs_speed_scale), windows_quality_vs_speed);
-                adw_spin_row_set_value(ADW_SPIN_ROW(startx_entry), startx);
-                adw_spin_row_set_value(ADW_SPIN_ROW(starty_entry), starty);
-                adw_spin_row_set_value(ADW_SPIN_ROW(vbv_buf_capacity_entry), vbv_buf_capacity);
-                adw_switch_row_set_active(ADW_SWITCH_ROW(tcp_upnp_switch), tcp_upnp);
-                adw_switch_row_set_active(ADW_SWITCH_ROW(sound_forwarding_switch), sound_forwarding);
-                adw_switch_row_set_active(ADW_SWITCH_ROW(hwencode_switch), hwencode);
-                adw_switch_row_set_active(ADW_SWITCH_ROW(vapostproc_switch), vapostproc);
-                adw_switch_row_set_active(ADW_SWITCH_ROW(color_downsampling_switch), !full_chroma);
-                adw_switch_row_set_active(ADW_SWITCH_ROW(bwe_switch), !no_bwe);
-                gtk_editable_set_text(GTK_EDITABLE(cert_entry), cert.c_str());
-                gtk_editable_set_text(GTK_EDITABLE(key_entry), key.c_str());
-
-                if (config.contains("endx")) {
-                    adw_spin_row_set_value(ADW_SPIN_ROW(endx_entry), toml::find<unsigned short>(config, "endx"));
-                    gtk_check_button_set_active(GTK_CHECK_BUTTON(endx_check_button), TRUE);
+                apply_settings(parse_settings(toml::parse(config_path / "config.toml")));
+            } catch (...) {
+                show_toast("Failed to parse existing settings at " + (config_path / "config.toml").string());
+            }
+        }
+    }
+
+    // Reads the settings on a worker thread, so that a slow disk can't hold up the
+    // window, and applies them from the main loop before calling on_loaded
+    void load_config(std::function<void()> on_loaded) {
+        struct Load {
+            std::filesystem::path config_path;
+            std::function<void()> on_loaded;
+            bool exists = false;
+            bool failed = false;
+            Settings settings;
+            std::map<std::string, SettingProfile> profiles;
+            std::vector<std::string> failed_profiles;
+        };
+
+        GTask* task = g_task_new(nullptr, nullptr, [](GObject*, GAsyncResult* result, void* data) {
+            auto tenebra = (MainWindow*) data;
+            auto load = (Load*) g_task_get_task_data(G_TASK(result));
+
+            if (!load->config_path.empty()) {
+                tenebra->set_profiles(std::move(load->profiles), load->failed_profiles);
+                if (!load->exists) {
+                    tenebra->new_user = true;
+                } else if (load->failed) {
+                    tenebra->show_toast("Failed to parse existing settings at " + (load->config_path / "config.toml").string());
                 } else {
-                    gtk_check_button_set_active(GTK_CHECK_BUTTON(endx_check_button), FALSE);
+                    tenebra->apply_settings(load->settings);
+                }
+            }
+            load->on_loaded();
+        },
+            this);
+        g_task_set_task_data(task, new Load {get_config_path(instance), std::move(on_loaded)}, [](void* data) {
+            delete (Load*) data;
+        });
+        g_task_run_in_thread(task, [](GTask* task, void*, void* task_data, GCancellable*) {
+            auto load = (Load*) task_data;
+            if (!load->config_path.empty()) {
+                try {
+                    if (!(load->exists = std::filesystem::exists(load->config_path / "config.toml"))) {
+                        std::filesystem::create_directories(load->config_path);
+                    } else {
+                        load->settings = parse_settings(toml::parse(load->config_path / "config.toml"));
+                    }
+                } catch (...) {
+                    load->failed = true;
                 }
+                load->profiles = read_profiles(load->config_path / "profiles", load->failed_profiles);
+            }
+            g_task_return_boolean(task, TRUE);
+        });
+        g_object_unref(task);
+    }
 
-                if (config.contains("endy")) {
-                    adw_spin_row_set_value(ADW_SPIN_ROW(endy_entry), toml::find<unsigned short>(config, "endy"));
-                    gtk_check_button_set_active(GTK_CHECK_BUTTON(endy_check_button), TRUE);
-                } else {
-                    gtk_check_button_set_active(GTK_CHECK_BUTTON(endy_check_button), FALSE);
+    // If mask is given, only the rows for those settings are set
+    void apply_settings(const Settings& settings, const SettingMask* mask = nullptr) {
+        applying_settings = true;
+        for (size_t i = 0; i < setting_count; ++i) {
+            const SettingSchema& setting = setting_schema[i];
+            GtkWidget* widget = setting_widgets[i];
+            if (!widget || (mask && !(*mask)[i])) continue;
+
+            const SettingValue& value = settings[i];
+            switch (setting.widget) {
+            case SettingWidget::Entry:
+            case SettingWidget::PasswordEntry:
+                gtk_editable_set_text(GTK_EDITABLE(widget), std::get<std::string>(value).c_str());
+                break;
+            case SettingWidget::SpinRow:
+                if (setting.optional) gtk_check_button_set_active(GTK_CHECK_BUTTON(setting_check_buttons[i]), value.index());
+                if (const long long* integer = std::get_if<long long>(&value)) {
+                    adw_spin_row_set_value(ADW_SPIN_ROW(widget), *integer);
                 }
+                break;
+            case SettingWidget::Scale:
+                gtk_range_set_value(GTK_RANGE(widget), std::get<long long>(value));
+                break;
+            case SettingWidget::SwitchRow:
+                adw_switch_row_set_active(ADW_SWITCH_ROW(widget), std::get<bool>(value));
+                break;
+            case SettingWidget::InvertedSwitchRow:
+                adw_switch_row_set_active(ADW_SWITCH_ROW(widget), !std::get<bool>(value));
+                break;
+            case SettingWidget::ComboRow:
+                adw_combo_row_set_selected(ADW_COMBO_ROW(widget), get_choice_index(setting, std::get<std::string>(value)));
+                break;
+            }
+        }
+        applying_settings = false;
+
+        // Rows that weren't touched keep any edits. Those that were are compared
+        // afresh too, since handlers like hwencode's can move other rows
+        Settings rows = get_settings();
+        if (!mask) config_saved = true;
+        for (size_t i = 0; i < setting_count; ++i) {
+            if (!mask || (*mask)[i]) applied_settings[i] = rows[i];
+            set_modified(i, rows[i] != applied_settings[i]);
+        }
+        disk_settings = settings;
+        update_profile_state();
+    }
 
-                gtk_widget_set_sensitive(save_button, dirty = false);
-            } catch (...) {
-                show_toast("Failed to parse existing settings at " + (config_path / "config.toml").string());
+    void load_profiles() {
+        std::vector<std::string> failed;
+        auto profiles = read_profiles(get_config_path(instance) / "profiles", failed);
+        set_profiles(std::move(profiles), failed);
+    }
+
+    // Lists the profiles in the menu, and names any that failed to parse
+    void set_profiles(std::map<std::string, SettingProfile> profiles, const std::vector<std::string>& failed = {}) {
+        this->profiles = std::move(profiles);
+        g_menu_remove_all(profile_menu);
+        for (const auto& [name, _] : this->profiles) {
+            glib::Object<GMenuItem> item = g_menu_item_new(name.c_str(), nullptr);
+            g_menu_item_set_action_and_target_value(item.get(), "app.profile", g_variant_new_string(name.c_str()));
+            g_menu_append_item(profile_menu, item.get());
+        }
+        if (this->profiles.empty()) {
+            g_menu_append(profile_menu, "No Profiles", nullptr); // Shown insensitive
+        }
+        update_profile_state();
+
+        if (!failed.empty()) {
+            std::string names;
+            for (const auto& name : failed) {
+                names += (names.empty() ? "" : ", ") + name;
             }
+            show_toast("Failed to load profiles in " + (get_config_path(instance) / "profiles").string() + ": " + names);
         }
     }
 
-    int start() {
-        if (save(false) == -1) return -1;
+    // Keeps the current profile if config.toml still matches it, and otherwise
+    // picks the first that does
+    void update_profile_state() {
+        auto matches = [this](const SettingProfile& profile) {
+            if (profile.mask.none()) return false; // It would match anything
+            for (size_t i = 0; i < setting_count; ++i) {
+                if (profile.mask[i] && profile.settings[i] != disk_settings[i]) return false;
+            }
+            return true;
+        };
+        if (auto it = profiles.find(current_profile); it == profiles.end() || !matches(it->second)) {
+            current_profile.clear();
+            for (const auto& [name, profile] : profiles) {
+                if (matches(profile)) {
+                    current_profile = name;
+                    break;
+                }
+            }
+        }
+        g_simple_action_set_state(profile_action, g_variant_new_string(current_profile.c_str()));
+        gtk_menu_button_set_label(GTK_MENU_BUTTON(profile_button), current_profile.empty() ? "Profiles" : current_profile.c_str());
+    }
 
-#ifdef _WIN32
-        SC_HANDLE sc_manager;
-        if (!(sc_manager = OpenSCManager(nullptr, nullptr, SC_MANAGER_CONNECT))) {
-            show_toast("Failed to start Tenebra (OpenSCManager failed, error " + std::to_string(GetLastError()) + ')');
+    // Writes the profile's settings into config.toml in one go, leaving any other
+    // unsaved edits as they are. Tenebra is only restarted if it's running and the
+    // profile changed something
+    int switch_profile(const std::string& name) {
+        auto it = profiles.find(name);
+        if (!loaded) {
+            return -1;
+        } else if (it == profiles.end()) {
+            show_toast("There's no profile named " + name);
             return -1;
         }
 
-        SC_HANDLE service;
-        if (!(service = OpenService(sc_manager, "Tenebra", SERVICE_START))) {
-            show_toast("Failed to start Tenebra (OpenSCManager failed, error " + std::to_string(GetLastError()) + ')');
-            CloseServiceHandle(sc_manager);
+        Settings settings = config_saved ? disk_settings : applied_settings;
+        for (size_t i = 0; i < setting_count; ++i) {
+            if (it->second.mask[i]) settings[i] = it->second.settings[i];
+        }
+        bool changed = settings != disk_settings || !config_saved;
+        if (write_config(settings) == -1) {
+            show_toast("Failed to save settings to " + (get_config_path(instance) / "config.toml").string());
             return -1;
         }
+        current_profile = name;
+        apply_settings(settings, &it->second.mask);
+
+        if (changed && tenebra_pid != -1) {
+            stop(false, [this, name](double latency) {
+                if (!launch()) {
+                    show_toast("Switched to " + name + " and restarted Tenebra (stopped in " + std::to_string((long) latency) + " ms)");
+                }
+            });
+        } else {
+            show_toast("Switched to " + name);
+        }
+        return 0;
+    }
+
+    void show_save_profile_dialog() {
+        AdwDialog* dialog = adw_alert_dialog_new("Save as Profile", "Saves the current video encoding settings and bandwidth estimation, so that they can be switched back to from the Profiles menu");
+        GtkWidget* name_entry = gtk_entry_new();
+        gtk_entry_set_placeholder_text(GTK_ENTRY(name_entry), "Name");
+        gtk_entry_set_activates_default(GTK_ENTRY(name_entry), TRUE);
+        if (!current_profile.empty()) gtk_editable_set_text(GTK_EDITABLE(name_entry), current_profile.c_str());
+        adw_alert_dialog_set_extra_child(ADW_ALERT_DIALOG(dialog), name_entry);
+        adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(dialog), "cancel", "Cancel", "save", "Save", nullptr);
+        adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog), "save", ADW_RESPONSE_SUGGESTED);
+        adw_alert_dialog_set_default_response(ADW_ALERT_DIALOG(dialog), "save");
+        adw_alert_dialog_set_close_response(ADW_ALERT_DIALOG(dialog), "cancel");
+        glib::connect_signal<char*>(dialog, "response", [this, name_entry](AdwDialog*, char* response) {
+            if (strcmp(response, "save")) return;
+
+            // Profile names become file names, so they follow the same rules as
+            // instance names
+            std::string name = gtk_editable_get_text(GTK_EDITABLE(name_entry));
+            if (!is_valid_instance_name(name)) {
+                show_toast("Profile names may only contain letters, digits, '-', '_' and '.'");
+                return;
+            }
+
+            SettingProfile profile;
+            Settings rows = get_settings();
+            for (size_t i = 0; i < setting_count; ++i) {
+                if (setting_schema[i].profile && (setting_schema[i].platforms & platform_current)) {
+                    profile.settings[i] = rows[i];
+                    profile.mask.set(i);
+                }
+            }
+
+            auto profile_path = get_config_path(instance) / "profiles" / (name + ".toml");
+            std::ostringstream contents;
+            contents << serialize_settings(profile.settings);
+            std::error_code ec;
+            std::filesystem::create_directories(profile_path.parent_path(), ec);
+            if (write_file_atomically(profile_path, contents.str()) == -1) {
+                show_toast("Failed to save profile to " + profile_path.string());
+                return;
+            }
+
+            auto profiles = this->profiles;
+            profiles[name] = std::move(profile);
+            set_profiles(std::move(profiles));
+            show_toast("Profile saved to " + profile_path.string());
+        });
+        adw_dialog_present(dialog, window);
+    }
+
+    // Follows config.toml, so that changes made by scripts or `tenebra-gtk set` show
+    // up here instead of being overwritten by the next save
+    void watch_config() {
+        if (config_reload_source) {
+            g_source_remove(config_reload_source);
+            config_reload_source = 0;
+        }
+        config_monitor.reset();
+
+        auto config_path = get_config_path(instance);
+        if (config_path.empty()) return;
+
+        glib::Object<GFile> file = g_file_new_for_path((config_path / "config.toml").string().c_str());
+        if (!(config_monitor = g_file_monitor_file(file.get(), G_FILE_MONITOR_NONE, nullptr, nullptr))) return;
+        config_monitor.connect_signal<GFile*, GFile*, GFileMonitorEvent>("changed", [this](GFileMonitor*, GFile*, GFile*, GFileMonitorEvent event) {
+            if (event == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED || event == G_FILE_MONITOR_EVENT_DELETED) return;
+
+            // A file written in several steps raises several events, so this waits
+            // for them to settle before reading it once
+            if (config_reload_source) g_source_remove(config_reload_source);
+            config_reload_source = g_timeout_add(250, [](void* data) -> gboolean {
+                auto tenebra = (MainWindow*) data;
+                tenebra->config_reload_source = 0;
+                tenebra->reload_config();
+                return G_SOURCE_REMOVE;
+            },
+                this);
+        });
+    }
+
+    // Applies whatever changed on disk to the rows that weren't edited here, and
+    // asks about the rest
+    void reload_config() {
+        auto config_path = get_config_path(instance);
+        if (!std::filesystem::exists(config_path / "config.toml")) return;
+
+        Settings settings;
+        try {
+            settings = parse_settings(toml::parse(config_path / "config.toml"));
+        } catch (...) {
+            show_toast("Failed to parse changed settings at " + (config_path / "config.toml").string());
+            return;
+        }
+
+        // Edits that happen to match the new value don't conflict with it
+        Settings rows = get_settings();
+        SettingMask changed = diff_settings(settings, disk_settings);
+        SettingMask edited = diff_settings(rows, applied_settings) & diff_settings(rows, settings);
+        if (changed.none()) return; // Most likely our own save
+
+        SettingMask conflicting = changed & edited;
+        SettingMask applying = changed & ~edited;
+        apply_settings(settings, &applying);
+
+        if (conflicting.none()) {
+            show_toast("Settings reloaded from " + (config_path / "config.toml").string());
+            return;
+        }
+
+        std::string names;
+        for (size_t i = 0; i < setting_count; ++i) {
+            if (conflicting[i]) names += (names.empty() ? "" : ", ") + std::string(setting_schema[i].title);
+        }
+        AdwDialog* dialog = adw_alert_dialog_new("Settings Changed", ("Settings you've edited here were also changed in " + (config_path / "config.toml").string() + ": " + names + ". The rest of the changes have been applied.").c_str());
+        adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(dialog), "keep", "Keep Mine", "reload", "Reload", nullptr);
+        adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog), "reload", ADW_RESPONSE_DESTRUCTIVE);
+        adw_alert_dialog_set_default_response(ADW_ALERT_DIALOG(dialog), "keep");
+        adw_alert_dialog_set_close_response(ADW_ALERT_DIALOG(dialog), "keep");
+        glib::connect_signal<char*>(dialog, "response", [this, settings = std::move(settings), conflicting](AdwDialog*, char* response) {
+            // Kept edits stay unsaved, so the next save writes them over the file
+            if (!strcmp(response, "reload") && settings == disk_settings) {
+                apply_settings(settings, &conflicting);
+            }
+        });
+        adw_dialog_present(dialog, window);
+    }
+
+    int start() {
+        if (save(false) == -1) return -1;
+#ifndef _WIN32
+        cancel_restart();
+#endif
+        return launch();
+    }
 
-        if (!StartService(service, 0, nullptr)) {
-            show_toast("Failed to start Tenebra (StartService failed, error " + std::to_string(GetLastError()) + ')');
-            CloseServiceHandle(service);
-            CloseServiceHandle(sc_manager);
+    // Starts Tenebra with the settings as they are, without saving them first
+    int launch() {
+#ifdef _WIN32
+        if (std::string error; start_tenebra_service(error) == -1) {
+            show_toast("Failed to start Tenebra (" + error + ')');
             return -1;
         }
 
-        CloseServiceHandle(service);
-        CloseServiceHandle(sc_manager);
+        // The service reports its PID asynchronously, so leave it to the next poll
+        set_button_state(running_box);
 #else
-        int pipe_fds[2];
-        if (pipe(pipe_fds) == -1) {
-            show_toast("Failed to start Tenebra (pipe failed, error " + std::to_string(errno) + ')');
+        Settings settings = get_settings();
+        TenebraSpawnOptions spawn_options;
+        if (get_tenebra_spawn_options(settings, instance, spawn_options) == -1) {
+            show_toast("Failed to start Tenebra (invalid CPU set \"" + std::get<std::string>(settings[setting_index("cpu_affinity")]) + "\")");
             return -1;
         }
+        SpawnOptions& options = spawn_options.options;
+    #ifdef __linux__
+        if (adw_switch_row_get_active(ADW_SWITCH_ROW(socket_activation_switch))) {
+            auto port = (unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(port_entry));
+            if (listen_fd != -1 && listen_port != port) {
+                close_listen_socket();
+            }
+            if (listen_fd == -1) {
+                if ((listen_fd = open_listen_socket(port)) == -1) {
+                    show_toast("Failed to start Tenebra (couldn't listen on port " + std::to_string(port) + ", error " + std::to_string(errno) + ')');
+                    return -1;
+                }
+                listen_port = port;
+            }
+            options.listen_fd = listen_fd;
+        } else {
+            close_listen_socket();
+        }
+    #endif
 
-        if (pid_t pid = fork(); pid == -1) {
-            show_toast("Failed to start Tenebra (fork failed, error " + std::to_string(errno) + ')');
-            close(pipe_fds[0]);
-            close(pipe_fds[1]);
+        if ((options.stdin_fd = open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1) {
+            show_toast("Failed to start Tenebra (open failed, error " + std::to_string(errno) + ')');
             return -1;
-        } else if (!pid) {
-            close(pipe_fds[0]); // Close unused read end
-            fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
-
-            int null_fd;
-            if ((null_fd = open("/dev/null", O_RDWR)) == -1) {
-                int error = errno;
-                write(pipe_fds[1], &error, sizeof(int));
-                close(pipe_fds[1]);
-                exit(EXIT_FAILURE);
-            }
-            dup2(null_fd, STDIN_FILENO);
-            dup2(null_fd, STDOUT_FILENO);
-            dup2(null_fd, STDERR_FILENO);
-            close(null_fd);
+        }
 
-            setsid();
-            if (execlp("tenebra", "tenebra", nullptr) == -1) {
-                int error = errno;
-                write(pipe_fds[1], &error, sizeof(int));
-                close(pipe_fds[1]);
-                exit(EXIT_FAILURE);
-            }
+        // Tenebra's output goes to a file that's tailed into log_buffer. Tenebra
+        // outlives the window, and once nothing read a pipe, its writes would fail
+        // with EPIPE, which Rust's println! panics on. Each launch gets a new file,
+        // so the previous one can still be read to the end
+        auto config_path = get_config_path(instance);
+        std::error_code ec;
+        std::filesystem::create_directories(config_path, ec);
+        std::filesystem::remove(config_path / "tenebra.out", ec);
+        int output_fd;
+        int tail_fd;
+        if (config_path.empty() || (output_fd = open((config_path / "tenebra.out").c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644)) == -1) {
+            show_toast("Failed to start Tenebra (couldn't create " + (config_path / "tenebra.out").string() + ", error " + std::to_string(errno) + ')');
+            close(options.stdin_fd);
+            return -1;
+        } else if ((tail_fd = open((config_path / "tenebra.out").c_str(), O_RDWR | O_CLOEXEC)) == -1) {
+            show_toast("Failed to start Tenebra (couldn't open " + (config_path / "tenebra.out").string() + ", error " + std::to_string(errno) + ')');
+            close(options.stdin_fd);
+            close(output_fd);
+            return -1;
         }
+        options.stdout_fd = output_fd;
+        options.stderr_fd = output_fd;
 
-        close(pipe_fds[1]); // Close unused write end
+        if (!config_path.empty() && adw_switch_row_get_active(ADW_SWITCH_ROW(save_log_switch))) {
+            log_buffer.set_spill_file(config_path / "tenebra.log");
+        } else {
+            log_buffer.set_spill_file({});
+        }
 
-        int error;
-        if (read(pipe_fds[0], &error, sizeof(int)) == sizeof(int)) {
+        launch_time = std::chrono::steady_clock::now();
+        char* const argv[] = {(char*) "tenebra", nullptr};
+        pid_t pid = spawn("tenebra", argv, options);
+        int error = errno;
+        close(options.stdin_fd);
+        close(output_fd);
+        if (pid == -1) {
             show_toast("Failed to start Tenebra (error " + std::to_string(error) + ')');
-            close(pipe_fds[0]);
+            close(tail_fd);
             return -1;
         }
+        capture_log(tail_fd, pid);
+        watch_launch(pid);
+
+    #ifdef __linux__
+        if (std::vector<const char*> refused = get_refused_spawn_options(pid, options); !refused.empty()) {
+            std::string list = refused[0];
+            for (size_t i = 1; i < refused.size(); ++i) {
+                list += i + 1 == refused.size() ? " and " : ", ";
+                list += refused[i];
+            }
+            show_toast("Tenebra was started without its " + list + " (not permitted)");
+        }
+    #endif
 
-        close(pipe_fds[0]);
+        launch_history.back().pidfile_set = !set_tenebra_pidfile(pid, instance);
+        starting_pid = pid;
+        set_tenebra_pid(pid);
+        probe_delay = 10;
+        probe_tenebra();
 #endif
         return 0;
     }
 
-    int stop(bool show_not_running_toast = true) {
-        if (pid_t pid = get_tenebra_pid(); pid != -1) {
+    // Asks Tenebra to exit. On POSIX this returns as soon as SIGTERM is sent, and
+    // on_stopped runs from the main loop once the process is gone. If it outlives
+    // the grace period, it's sent SIGKILL
+    int stop(bool show_not_running_toast = true, std::function<void(double)> on_stopped = nullptr) {
+#ifndef _WIN32
+        if (stopping_pid != -1) return -1;
+        cancel_restart();
+#endif
+
+        if (pid_t pid = get_current_tenebra_pid(); pid != -1) {
 #ifdef _WIN32
-            HANDLE process;
-            if ((process = OpenProcess(PROCESS_TERMINATE, FALSE, pid)) == nullptr) {
-                show_toast("Failed to stop Tenebra (OpenProcess failed, error " + std::to_string(GetLastError()) + ')');
+            auto stop_time = std::chrono::steady_clock::now();
+            if (std::string error; terminate_tenebra_process(pid, error) == -1) {
+                show_toast("Failed to stop Tenebra (" + error + ')');
                 return -1;
             }
-            if (!TerminateProcess(process, 1)) {
-                show_toast("Failed to stop Tenebra (TerminateProcess failed, error " + std::to_string(GetLastError()) + ')');
-                CloseHandle(process);
-                return -1;
+
+            set_tenebra_pid(-1);
+            double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stop_time).count();
+            if (on_stopped) {
+                on_stopped(latency);
+            } else {
+                show_toast("Tenebra stopped in " + std::to_string((long) latency) + " ms");
             }
-            CloseHandle(process);
 #else
-            if (kill(pid, SIGTERM) == -1) {
-                show_toast("Failed to stop Tenebra (kill failed, error " + std::to_string(errno) + ')');
+            stopping_pid = pid;
+            for (auto& launch : launch_history) {
+                if (launch.pid == pid && !launch.exited) launch.stopped = true;
+            }
+            this->on_stopped = std::move(on_stopped);
+            stop_time = std::chrono::steady_clock::now();
+            stop_killed = false;
+
+            if (int result = terminate_tenebra(pid, instance, stopping_pidfd); result == 1) {
+                finish_stop();
+                return 0;
+            } else if (result == -1) {
+                int error = errno;
+                cancel_stop();
+                show_toast("Failed to stop Tenebra (kill failed, error " + std::to_string(error) + ')');
                 return -1;
             }
 
-            // Wait for Tenebra to die
-            for (;; std::this_thread::sleep_for(std::chrono::milliseconds(10))) {
-                if (kill(pid, 0) == -1 && errno == ESRCH) {
-                    break;
-                }
+            gtk_widget_set_sensitive(running_box, FALSE);
+            gtk_button_set_label(GTK_BUTTON(stop_button), "Stopping…");
+
+            if (stopping_pidfd != -1) {
+                stop_wait_source = g_unix_fd_add(stopping_pidfd, G_IO_IN, [](int, GIOCondition, void* data) -> gboolean {
+                    auto tenebra = (MainWindow*) data;
+                    tenebra->stop_wait_source = 0;
+                    tenebra->finish_stop();
+                    return G_SOURCE_REMOVE;
+                },
+                    this);
+            } else {
+                stop_wait_source = g_timeout_add(10, [](void* data) -> gboolean {
+                    auto tenebra = (MainWindow*) data;
+                    if (wait_for_exit(tenebra->stopping_pid, -1, 0)) {
+                        tenebra->stop_wait_source = 0;
+                        tenebra->finish_stop();
+                        return G_SOURCE_REMOVE;
+                    }
+                    return G_SOURCE_CONTINUE;
+                },
+                    this);
             }
+
+            stop_kill_source = g_timeout_add_seconds((guint) adw_spin_row_get_value(ADW_SPIN_ROW(shutdown_grace_period_entry)), [](void* data) -> gboolean {
+                auto tenebra = (MainWindow*) data;
+                tenebra->stop_kill_source = 0;
+                kill_tenebra(tenebra->stopping_pid, tenebra->stopping_pidfd);
+                tenebra->stop_killed = true;
+                gtk_button_set_label(GTK_BUTTON(tenebra->stop_button), "Killing…");
+                return G_SOURCE_REMOVE;
+            },
+                this);
 #endif
-        } else if (show_not_running_toast) {
-            show_toast("Tenebra wasn't running in the first place 🫤");
+        } else {
+            if (show_not_running_toast) {
+                show_toast("Tenebra wasn't running in the first place 🫤");
+            }
+            set_tenebra_pid(-1);
+            if (on_stopped) on_stopped(0.);
         }
         return 0;
     }
 
-    int save(bool show_success_toast = true) {
-        auto config_path = get_config_path();
-        if (!config_path.empty()) {
-            if (!std::filesystem::exists(config_path)) {
-                std::filesystem::create_directory(config_path);
-            }
-
-            std::ofstream config_file(config_path / "config.toml");
-            if (config_file.is_open()) {
-                toml::value config({
-                    {"password", gtk_editable_get_text(GTK_EDITABLE(password_entry))},
-                    {"port", (unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(port_entry))},
-                    {"target_bitrate", (unsigned int) adw_spin_row_get_value(ADW_SPIN_ROW(target_bitrate_entry))},
-                    {"windows_monitor_index", (int) adw_spin_row_get_value(ADW_SPIN_ROW(windows_monitor_index_entry))},
-                    {"windows_capture_api", pw::string::to_lower_copy(gtk_string_list_get_string(GTK_STRING_LIST(adw_combo_row_get_model(ADW_COMBO_ROW(windows_capture_api_combo_box))), adw_combo_row_get_selected(ADW_COMBO_ROW(windows_capture_api_combo_box))))},
-                    {"windows_quality_vs_speed", (unsigned short) gtk_range_get_value(GTK_RANGE(windows_quality_vs_speed_scale))},
-                    {"startx", (unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(startx_entry))},
-                    {"starty", (unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(starty_entry))},
-                    {"vbv_buf_capacity", (unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(vbv_buf_capacity_entry))},
-                    {"tcp_upnp", (bool) adw_switch_row_get_active(ADW_SWITCH_ROW(tcp_upnp_switch))},
-                    {"sound_forwarding", (bool) adw_switch_row_get_active(ADW_SWITCH_ROW(sound_forwarding_switch))},
-                    {"hwencode", (bool) adw_switch_row_get_active(ADW_SWITCH_ROW(hwencode_switch))},
-                    {"vapostproc", (bool) adw_switch_row_get_active(ADW_SWITCH_ROW(vapostproc_switch))},
-                    {"full_chroma", !adw_switch_row_get_active(ADW_SWITCH_ROW(color_downsampling_switch))},
-                    {"no_bwe", !adw_switch_row_get_active(ADW_SWITCH_ROW(bwe_switch))},
-                    {"cert", gtk_editable_get_text(GTK_EDITABLE(cert_entry))},
-                    {"key", gtk_editable_get_text(GTK_EDITABLE(key_entry))},
-                });
-                if (gtk_check_button_get_active(GTK_CHECK_BUTTON(endx_check_button))) {
-                    config["endx"] = (unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(endx_entry));
-                }
-                if (gtk_check_button_get_active(GTK_CHECK_BUTTON(endy_check_button))) {
-                    config["endy"] = (unsigned short) adw_spin_row_get_value(ADW_SPIN_ROW(endy_entry));
-                }
+#ifndef _WIN32
+    // Forgets the stop in progress without touching the process
+    void cancel_stop() {
+        if (stop_wait_source) {
+            g_source_remove(stop_wait_source);
+            stop_wait_source = 0;
+        }
+        if (stop_kill_source) {
+            g_source_remove(stop_kill_source);
+            stop_kill_source = 0;
+        }
+        if (stopping_pidfd != -1) {
+            close(stopping_pidfd);
+            stopping_pidfd = -1;
+        }
+        stopping_pid = -1;
+        gtk_widget_set_sensitive(running_box, TRUE);
+        gtk_button_set_label(GTK_BUTTON(stop_button), "Stop");
+    }
 
-                if (config_file << config << std::flush) {
-                    gtk_widget_set_sensitive(save_button, dirty = false);
-                    if (show_success_toast) {
-                        show_toast("Settings saved to " + (config_path / "config.toml").string());
-                    }
-                    return 0;
-                }
+    void finish_stop() {
+        double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stop_time).count();
+        bool killed = stop_killed;
+        cancel_stop();
+        set_tenebra_pid(-1);
+
+        if (auto on_stopped = std::exchange(this->on_stopped, nullptr)) {
+            on_stopped(latency);
+        } else if (killed) {
+            show_toast("Tenebra was killed after not stopping within " + std::to_string((long) latency) + " ms");
+        } else {
+            show_toast("Tenebra stopped in " + std::to_string((long) latency) + " ms");
+        }
+    }
+#endif
+
+    // The setting as its row currently shows it. Settings without rows on this
+    // platform keep their defaults
+    SettingValue get_setting(size_t i) {
+        static const Settings default_settings = get_default_settings();
+        const SettingSchema& setting = setting_schema[i];
+        GtkWidget* widget = setting_widgets[i];
+        if (!widget) return default_settings[i];
+
+        switch (setting.widget) {
+        case SettingWidget::Entry:
+        case SettingWidget::PasswordEntry:
+            return std::string(gtk_editable_get_text(GTK_EDITABLE(widget)));
+        case SettingWidget::SpinRow:
+            if (setting.optional && !gtk_check_button_get_active(GTK_CHECK_BUTTON(setting_check_buttons[i]))) {
+                return std::monostate();
             }
+            return (long long) adw_spin_row_get_value(ADW_SPIN_ROW(widget));
+        case SettingWidget::Scale:
+            return (long long) gtk_range_get_value(GTK_RANGE(widget));
+        case SettingWidget::SwitchRow:
+            return (bool) adw_switch_row_get_active(ADW_SWITCH_ROW(widget));
+        case SettingWidget::InvertedSwitchRow:
+            return !adw_switch_row_get_active(ADW_SWITCH_ROW(widget));
+        case SettingWidget::ComboRow:
+            if (guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(widget)); selected < setting.choices.size()) {
+                return std::string(setting.choices[selected].value);
+            }
+            break;
+        }
+        return default_settings[i];
+    }
+
+    Settings get_settings() {
+        Settings ret;
+        for (size_t i = 0; i < setting_count; ++i) {
+            ret[i] = get_setting(i);
+        }
+        return ret;
+    }
+
+    // Skipped if the settings are what was last written and nobody else has written
+    // the file since, which spares the disk flush and any watchers. Returns 0, or -1
+    // with config.toml untouched
+    int write_config(const Settings& settings) {
+        auto config_path = get_config_path(instance);
+        if (config_path.empty()) return -1;
+
+        std::error_code ec;
+        if (!std::filesystem::exists(config_path)) {
+            std::filesystem::create_directories(config_path, ec);
         }
 
-        show_toast("Failed to save settings to " + (config_path / "config.toml").string());
+        std::ostringstream contents;
+        contents << serialize_settings(settings);
+
+        size_t hash = std::hash<std::string>()(contents.str());
+        if ((hash == config_hash && std::filesystem::last_write_time(config_path / "config.toml", ec) == config_write_time) ||
+            write_file_atomically(config_path / "config.toml", contents.str()) == 0) {
+            config_hash = hash;
+            config_write_time = std::filesystem::last_write_time(config_path / "config.toml", ec);
+            config_saved = true;
+            return 0;
+        }
         return -1;
     }
+
+    int save(bool show_success_toast = true) {
+        Settings settings = get_settings();
+        if (write_config(settings) == -1) {
+            show_toast("Failed to save settings to " + (get_config_path(instance) / "config.toml").string());
+            return -1;
+        }
+
+        disk_settings = applied_settings = std::move(settings);
+        for (size_t i = 0; i < setting_count; ++i) {
+            set_modified(i, false);
+        }
+        update_profile_state();
+        if (show_success_toast) {
+            show_toast("Settings saved to " + (get_config_path(instance) / "config.toml").string());
+        }
+        return 0;
+    }
 };
 
 int main(int argc, char* argv[]) {
@@ -817,6 +2688,11 @@ int main(int argc, char* argv[]) {
         std::ios::sync_with_stdio();
     }
 
+    // Before elevation, which would open a new window instead of printing here
+    if (int ret = run_command(argc, argv); ret != -1) {
+        return ret;
+    }
+
     BOOL is_admin = FALSE;
     SID_IDENTIFIER_AUTHORITY nt_authority = SECURITY_NT_AUTHORITY;
     if (PSID admin_group; AllocateAndInitializeSid(&nt_authority, 2, SECURITY_BUILTIN_DOMAIN_RID, DOMAIN_ALIAS_RID_ADMINS, 0, 0, 0, 0, 0, 0, &admin_group)) {
@@ -837,9 +2713,15 @@ int main(int argc, char* argv[]) {
         return EXIT_SUCCESS;
     }
 #else
-    signal(SIGCHLD, [](int) {
-        waitpid(-1, nullptr, WNOHANG);
-    });
+    // Ignored dispositions survive exec, so Tenebra inherits this. It outlives the
+    // window, after which its output has no reader, and losing that output is
+    // better than being killed for it
+    signal(SIGPIPE, SIG_IGN);
+
+    // Without initializing GTK, so that these work without a display
+    if (int ret = run_command(argc, argv); ret != -1) {
+        return ret;
+    }
 #endif
 
     (void) pn::init();
@@ -0,0 +1,139 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <charconv>
+#include <ctype.h>
+#include <string.h>
+
+static size_t find_keyword(std::string_view line, std::string_view keyword) {
+    if (line.size() < keyword.size()) return std::string_view::npos;
+    for (size_t i = 0; i <= line.size() - keyword.size(); ++i) {
+        size_t j = 0;
+        while (j < keyword.size() && tolower((unsigned char) line[i + j]) == keyword[j]) ++j;
+        if (j == keyword.size()) return i;
+    }
+    return std::string_view::npos;
+}
+
+// Parses the number starting at begin along with the word after it
+static bool parse_value(std::string_view line, size_t begin, MetricReading& reading) {
+    double value;
+    auto result = std::from_chars(line.data() + begin, line.data() + line.size(), value);
+    if (result.ec != std::errc()) return false;
+    reading.value = value;
+
+    const char* unit_begin = result.ptr;
+    while (unit_begin < line.data() + line.size() && *unit_begin == ' ') ++unit_begin;
+    const char* unit_end = unit_begin;
+    while (unit_end < line.data() + line.size() && unit_end - unit_begin < (ptrdiff_t) sizeof reading.unit - 1 && (isalpha((unsigned char) *unit_end) || *unit_end == '/')) ++unit_end;
+    memcpy(reading.unit, unit_begin, unit_end - unit_begin);
+    reading.unit[unit_end - unit_begin] = '\0';
+    return true;
+}
+
+void MetricExtractor::match(std::string_view line, MetricReadings& readings) {
+    for (size_t i = 0; i < metric_count; ++i) {
+        size_t keyword_pos;
+        if ((keyword_pos = find_keyword(line, metric_rules[i].keyword)) == std::string_view::npos) {
+            continue;
+        }
+
+        MetricReading reading;
+        size_t after = keyword_pos + metric_rules[i].keyword.size();
+        size_t number_pos = std::find_if(line.begin() + after, line.end(), [](char c) {
+            return isdigit((unsigned char) c);
+        }) - line.begin();
+        if (number_pos == line.size()) {
+            // Walk back over the last number before the keyword, if there is one
+            size_t end = keyword_pos;
+            while (end && !isdigit((unsigned char) line[end - 1])) --end;
+            number_pos = end;
+            while (number_pos && (isdigit((unsigned char) line[number_pos - 1]) || line[number_pos - 1] == '.')) --number_pos;
+            if (number_pos == end) number_pos = line.size();
+        }
+
+        if (number_pos == line.size() || !parse_value(line, number_pos, reading)) {
+            if (metric_rules[i].aggregation != MetricAggregation::Sum) continue;
+            reading.value = 1.;
+        }
+
+        if (metric_rules[i].aggregation == MetricAggregation::Sum && readings[i].matched) {
+            readings[i].value += reading.value;
+        } else {
+            readings[i] = reading;
+            readings[i].matched = true;
+        }
+    }
+}
+
+void MetricExtractor::run() {
+    std::string lines;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() {
+                return stopping || !pending.empty();
+            });
+            if (stopping) return;
+            lines.swap(pending);
+        }
+
+        MetricReadings batch_readings;
+        for (size_t begin = 0, end; begin < lines.size(); begin = end + 1) {
+            end = lines.find('\n', begin);
+            match(std::string_view(lines).substr(begin, end - begin), batch_readings);
+        }
+        lines.clear();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < metric_count; ++i) {
+            if (!batch_readings[i].matched) continue;
+            if (metric_rules[i].aggregation == MetricAggregation::Sum && readings[i].matched) {
+                readings[i].value += batch_readings[i].value;
+            } else {
+                readings[i] = batch_readings[i];
+            }
+        }
+    }
+}
+
+MetricExtractor::~MetricExtractor() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_one();
+        worker.join();
+    }
+}
+
+void MetricExtractor::feed(std::string_view line) {
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable()) {
+            worker = std::thread(&MetricExtractor::run, this);
+        }
+        was_empty = pending.empty();
+        if (pending.size() + line.size() + 1 > max_pending_size) {
+            // Half goes at once, so that a flood doesn't move the buffer every line
+            size_t end = pending.find('\n', pending.size() / 2);
+            end = end == std::string::npos ? pending.size() : end + 1;
+            dropped += std::count(pending.begin(), pending.begin() + end, '\n');
+            pending.erase(0, end);
+        }
+        pending.append(line);
+        pending.push_back('\n');
+    }
+
+    // The worker only waits once it's drained everything, so it only needs waking
+    // for the first line of a batch
+    if (was_empty) condition.notify_one();
+}
+
+MetricReadings MetricExtractor::take() {
+    std::lock_guard<std::mutex> lock(mutex);
+    MetricReadings ret = readings;
+    readings = {};
+    return ret;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum class MetricAggregation {
+    Latest, // Gauges like the frame rate, where only the newest reading matters
+    Sum,    // Events like dropped frames, which are added up
+};
+
+struct MetricRule {
+    const char* title;
+    std::string_view keyword; // Lowercase, and matched case-insensitively
+    MetricAggregation aggregation;
+};
+
+// A line matches a rule when it contains the keyword. Its value is the first number
+// after the keyword, or failing that the last number before it, so both
+// "fps: 60" and "60 fps" read as 60. A Sum line without a number counts as 1
+inline constexpr MetricRule metric_rules[] = {
+    {"Frame Rate", "fps", MetricAggregation::Latest},
+    {"Bitrate", "bitrate", MetricAggregation::Latest},
+    {"Estimated Bandwidth", "bandwidth", MetricAggregation::Latest},
+    {"Dropped Frames", "dropped", MetricAggregation::Sum},
+};
+inline constexpr size_t metric_count = std::size(metric_rules);
+
+struct MetricReading {
+    bool matched = false;
+    double value = 0.;
+    char unit[16] = {}; // The word after the value, like "kbps"
+};
+
+using MetricReadings = std::array<MetricReading, metric_count>;
+
+// Runs metric_rules over log lines on a worker thread. Lines are queued into one
+// buffer that the worker swaps out whole, and both buffers keep their capacity, so
+// once warmed up neither side allocates per line. If the worker falls behind, the
+// oldest queued lines are dropped to keep the buffer bounded
+class MetricExtractor {
+protected:
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::string pending; // Newline-terminated lines waiting for the worker
+    size_t dropped = 0;  // Lines dropped from pending
+    bool stopping = false;
+    MetricReadings readings; // Accumulated since the last take()
+
+    void run();
+
+public:
+    static constexpr size_t max_pending_size = 1 << 20;
+
+    MetricExtractor() = default;
+    MetricExtractor(const MetricExtractor&) = delete;
+    MetricExtractor& operator=(const MetricExtractor&) = delete;
+    ~MetricExtractor();
+
+    void feed(std::string_view line);
+
+    // Returns what's been matched since the last call and starts over
+    MetricReadings take();
+
+    size_t get_dropped() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return dropped;
+    }
+
+    static void match(std::string_view line, MetricReadings& readings);
+};
@@ -0,0 +1,163 @@
+#include "monitor.hpp"
+#include "util.hpp"
+#ifdef __linux__
+    #include <ctype.h>
+    #include <fcntl.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <string>
+    #include <unistd.h>
+
+static ssize_t pread_all(int fd, char* buf, size_t size) {
+    ssize_t ret;
+    if ((ret = pread(fd, buf, size - 1, 0)) == -1) {
+        return -1;
+    }
+    buf[ret] = '\0';
+    return ret;
+}
+
+// Finds "key:" at the start of a line in a status-style file and parses the number
+// after it
+static unsigned long long find_field(const char* buf, const char* key) {
+    size_t key_size = strlen(key);
+    for (const char* line = buf; line; line = strchr(line, '\n')) {
+        if (*line == '\n') ++line;
+        if (!strncmp(line, key, key_size) && line[key_size] == ':') {
+            return strtoull(line + key_size + 1, nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+// Parses /proc/<pid>/stat or /proc/<pid>/task/<tid>/stat. Fields are counted from
+// after comm, since comm may contain spaces. utime and stime are fields 14 and 15,
+// and num_threads is field 20
+static bool parse_stat(const char* buf, std::string* comm, unsigned long long& cpu_time, unsigned int* threads = nullptr) {
+    const char* comm_begin = strchr(buf, '(');
+    const char* field = strrchr(buf, ')');
+    if (!comm_begin || !field || field < comm_begin) return false;
+    if (comm) comm->assign(comm_begin + 1, field);
+
+    unsigned long long fields[21] = {};
+    for (int i = 3; i <= 20 && *field; ++i) {
+        while (*++field == ' ') {}
+        fields[i] = strtoull(field, (char**) &field, 10);
+    }
+    cpu_time = fields[14] + fields[15];
+    if (threads) *threads = fields[20];
+    return true;
+}
+
+int ProcessMonitor::open(pid_t pid) {
+    close();
+
+    std::string path = get_proc_root() / std::to_string(pid);
+    if ((stat_fd = ::open((path + "/stat").c_str(), O_RDONLY | O_CLOEXEC)) == -1 ||
+        (statm_fd = ::open((path + "/statm").c_str(), O_RDONLY | O_CLOEXEC)) == -1 ||
+        (status_fd = ::open((path + "/status").c_str(), O_RDONLY | O_CLOEXEC)) == -1) {
+        close();
+        return -1;
+    }
+    io_fd = ::open((path + "/io").c_str(), O_RDONLY | O_CLOEXEC);
+    task_dir = opendir((path + "/task").c_str());
+
+    this->pid = pid;
+    return 0;
+}
+
+void ProcessMonitor::close() {
+    for (int* fd : {&stat_fd, &statm_fd, &status_fd, &io_fd}) {
+        if (*fd != -1) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+    if (task_dir) {
+        closedir(task_dir);
+        task_dir = nullptr;
+    }
+    for (const auto& [tid, fd] : thread_stat_fds) {
+        ::close(fd);
+    }
+    thread_stat_fds.clear();
+    pid = -1;
+}
+
+int ProcessMonitor::sample(ProcessSample& ret) const {
+    if (pid == -1) return -1;
+    ret.time = std::chrono::steady_clock::now();
+
+    // Once the process exits, reads from its procfs files fail with ESRCH
+    char buf[4096];
+    if (pread_all(stat_fd, buf, sizeof buf) == -1) {
+        return -1;
+    }
+    if (!parse_stat(buf, nullptr, ret.cpu_time, &ret.threads)) {
+        return -1;
+    }
+
+    if (pread_all(statm_fd, buf, sizeof buf) == -1) {
+        return -1;
+    }
+    char* end;
+    strtoull(buf, &end, 10); // Skip size
+    ret.rss = strtoull(end, nullptr, 10) * sysconf(_SC_PAGESIZE);
+
+    if (pread_all(status_fd, buf, sizeof buf) == -1) {
+        return -1;
+    }
+    ret.voluntary_context_switches = find_field(buf, "voluntary_ctxt_switches");
+    ret.involuntary_context_switches = find_field(buf, "nonvoluntary_ctxt_switches");
+
+    if ((ret.has_io = io_fd != -1 && pread_all(io_fd, buf, sizeof buf) != -1)) {
+        ret.read_bytes = find_field(buf, "read_bytes");
+        ret.write_bytes = find_field(buf, "write_bytes");
+    }
+    return 0;
+}
+
+int ProcessMonitor::sample_threads(std::vector<ThreadSample>& ret) {
+    ret.clear();
+    if (!task_dir) return -1;
+
+    // Rewinding makes the next readdir list the threads as they are now
+    rewinddir(task_dir);
+    std::unordered_map<pid_t, int> stat_fds;
+    for (struct dirent* entry; ret.size() < max_threads && (entry = readdir(task_dir));) {
+        if (!isdigit((unsigned char) entry->d_name[0])) continue;
+        pid_t tid = atoi(entry->d_name);
+
+        int fd;
+        if (auto it = thread_stat_fds.find(tid); it != thread_stat_fds.end()) {
+            fd = it->second;
+            thread_stat_fds.erase(it);
+        } else if ((fd = openat(dirfd(task_dir), (std::string(entry->d_name) + "/stat").c_str(), O_RDONLY | O_CLOEXEC)) == -1) {
+            continue;
+        }
+
+        char buf[1024];
+        ThreadSample sample = {.tid = tid};
+        if (pread_all(fd, buf, sizeof buf) == -1 || !parse_stat(buf, &sample.comm, sample.cpu_time)) {
+            ::close(fd); // The thread exited while being listed
+            continue;
+        }
+        stat_fds[tid] = fd;
+        ret.push_back(std::move(sample));
+    }
+
+    // Anything left over belongs to a thread that's gone
+    for (const auto& [tid, fd] : thread_stat_fds) {
+        ::close(fd);
+    }
+    thread_stat_fds = std::move(stat_fds);
+    return 0;
+}
+
+double get_cpu_usage(const ProcessSample& previous, const ProcessSample& current) {
+    static const long ticks_per_second = sysconf(_SC_CLK_TCK);
+    std::chrono::duration<double> elapsed = current.time - previous.time;
+    if (elapsed.count() <= 0.) return 0.;
+    return (current.cpu_time - previous.cpu_time) / (double) ticks_per_second / elapsed.count() * 100.;
+}
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#ifdef __linux__
+    #include <chrono>
+    #include <dirent.h>
+    #include <string>
+    #include <sys/types.h>
+    #include <unordered_map>
+    #include <vector>
+
+struct ProcessSample {
+    std::chrono::steady_clock::time_point time;
+    unsigned long long cpu_time = 0; // utime + stime, in clock ticks
+    unsigned long long rss = 0;      // In bytes
+    unsigned int threads = 0;
+    unsigned long long voluntary_context_switches = 0;
+    unsigned long long involuntary_context_switches = 0;
+    bool has_io = false; // /proc/<pid>/io needs ptrace access, which may be denied
+    unsigned long long read_bytes = 0;
+    unsigned long long write_bytes = 0;
+};
+
+struct ThreadSample {
+    pid_t tid;
+    std::string comm;
+    unsigned long long cpu_time; // utime + stime, in clock ticks
+};
+
+// Samples a process's resource usage from procfs. The files are opened once and
+// reread with pread, so a sample costs one syscall per file
+class ProcessMonitor {
+protected:
+    pid_t pid = -1;
+    int stat_fd = -1;
+    int statm_fd = -1;
+    int status_fd = -1;
+    int io_fd = -1;
+
+    DIR* task_dir = nullptr;
+    std::unordered_map<pid_t, int> thread_stat_fds;
+
+public:
+    // Caps the cost of sample_threads() for processes with huge thread pools
+    static constexpr size_t max_threads = 256;
+
+    ProcessMonitor() = default;
+    ProcessMonitor(const ProcessMonitor&) = delete;
+    ProcessMonitor& operator=(const ProcessMonitor&) = delete;
+    ~ProcessMonitor() {
+        close();
+    }
+
+    int open(pid_t pid);
+    void close();
+
+    pid_t get_pid() const {
+        return pid;
+    }
+
+    // Returns -1 once the process is gone
+    int sample(ProcessSample& ret) const;
+    // Samples up to max_threads of the process's threads. Each thread's stat file is
+    // kept open between calls, and closed once the thread is gone
+    int sample_threads(std::vector<ThreadSample>& ret);
+};
+
+// The CPU usage between two samples as a percentage of one core, like top shows it
+double get_cpu_usage(const ProcessSample& previous, const ProcessSample& current);
+#endif
@@ -0,0 +1,101 @@
+#include "settings.hpp"
+#include <stdexcept>
+
+Settings get_default_settings() {
+    Settings ret;
+    for (size_t i = 0; i < setting_count; ++i) {
+        const SettingSchema& setting = setting_schema[i];
+        if (setting.optional) continue;
+        switch (setting.get_type()) {
+        case SettingType::Boolean:
+            ret[i] = setting.default_boolean;
+            break;
+        case SettingType::Integer:
+            ret[i] = setting.default_integer;
+            break;
+        case SettingType::String:
+            ret[i] = std::string(setting.default_string);
+            break;
+        }
+    }
+    return ret;
+}
+
+// One lookup per setting, rather than one per toml::find() call
+Settings parse_settings(const toml::value& config, SettingMask* found) {
+    Settings ret = get_default_settings();
+    if (found) found->reset();
+    const toml::table& table = config.as_table();
+    for (size_t i = 0; i < setting_count; ++i) {
+        const SettingSchema& setting = setting_schema[i];
+        auto it = table.find(std::string(setting.key));
+        if (it == table.end() && !setting.alias.empty()) {
+            it = table.find(std::string(setting.alias));
+        }
+        if (it == table.end()) continue;
+        if (found) found->set(i);
+
+        const toml::value& value = it->second;
+        switch (setting.get_type()) {
+        case SettingType::Boolean:
+            if (!value.is_boolean()) throw std::runtime_error(std::string(setting.key) + " must be true or false");
+            ret[i] = value.as_boolean();
+            break;
+        case SettingType::Integer:
+            if (!value.is_integer()) throw std::runtime_error(std::string(setting.key) + " must be an integer");
+            ret[i] = (long long) value.as_integer();
+            break;
+        case SettingType::String:
+            if (!value.is_string()) throw std::runtime_error(std::string(setting.key) + " must be a string");
+            ret[i] = value.as_string().str;
+            break;
+        }
+    }
+    return ret;
+}
+
+toml::value serialize_settings(const Settings& settings) {
+    toml::value ret = toml::table();
+    for (size_t i = 0; i < setting_count; ++i) {
+        if (!(setting_schema[i].platforms & platform_current)) continue;
+        std::string key(setting_schema[i].key);
+        if (const bool* boolean = std::get_if<bool>(&settings[i])) {
+            ret[key] = *boolean;
+        } else if (const long long* integer = std::get_if<long long>(&settings[i])) {
+            ret[key] = *integer;
+        } else if (const std::string* string = std::get_if<std::string>(&settings[i])) {
+            ret[key] = *string;
+        }
+    }
+    return ret;
+}
+
+SettingMask diff_settings(const Settings& a, const Settings& b) {
+    SettingMask ret;
+    for (size_t i = 0; i < setting_count; ++i) {
+        ret[i] = a[i] != b[i];
+    }
+    return ret;
+}
+
+std::map<std::string, SettingProfile> read_profiles(const std::filesystem::path& profiles_path, std::vector<std::string>& failed) {
+    std::map<std::string, SettingProfile> ret;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(profiles_path, ec)) {
+        if (entry.path().extension() != ".toml" || !entry.is_regular_file(ec)) continue;
+
+        std::string name = entry.path().stem().string();
+        try {
+            SettingProfile profile;
+            profile.settings = parse_settings(toml::parse(entry.path()), &profile.mask);
+            if (profile.mask.none()) {
+                failed.push_back(std::move(name));
+                continue;
+            }
+            ret[name] = std::move(profile);
+        } catch (...) {
+            failed.push_back(std::move(name));
+        }
+    }
+    return ret;
+}
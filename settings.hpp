@@ -0,0 +1,183 @@
+#pragma once
+
+#include "toml.hpp"
+#include <array>
+#include <bitset>
+#include <filesystem>
+#include <iterator>
+#include <map>
+#include <span>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+enum class SettingType {
+    Boolean,
+    Integer,
+    String,
+};
+
+// How a setting is edited, which also decides its type
+enum class SettingWidget {
+    Entry,
+    PasswordEntry,
+    SpinRow,
+    Scale,             // An action row with a slider beside its title
+    SwitchRow,
+    InvertedSwitchRow, // On when the setting is false, for settings named in the negative
+    ComboRow,          // A string picked from choices
+};
+
+// The preferences group a setting's row goes in
+enum class SettingGroup {
+    Connection,
+    Capture,
+    Video,
+    Audio,
+    Network,
+    Process,
+    Scheduling,
+    Security,
+};
+inline constexpr size_t setting_group_count = 8;
+
+// Masks of the platforms a setting is saved on
+inline constexpr unsigned platform_windows = 1 << 0;
+inline constexpr unsigned platform_macos = 1 << 1;
+inline constexpr unsigned platform_linux = 1 << 2;
+inline constexpr unsigned platform_posix = platform_macos | platform_linux;
+inline constexpr unsigned platform_all = platform_windows | platform_posix;
+#ifdef _WIN32
+inline constexpr unsigned platform_current = platform_windows;
+#elif defined(__APPLE__)
+inline constexpr unsigned platform_current = platform_macos;
+#else
+inline constexpr unsigned platform_current = platform_linux;
+#endif
+
+struct SettingChoice {
+    std::string_view value; // As saved
+    const char* label;
+};
+
+struct SettingSchema {
+    std::string_view key;
+    SettingWidget widget;
+    SettingGroup group;
+    const char* title;
+    const char* description = nullptr; // The subtitle, or the tooltip of an entry row
+    bool default_boolean = false;
+    long long default_integer = 0;
+    std::string_view default_string = {};
+    long long min = 0; // Integer settings only
+    long long max = 0;
+    std::span<const SettingChoice> choices = {};
+    bool optional = false;      // Absent unless set, like the end of the capture region
+    std::string_view alias = {}; // An older key that's read when this one is missing
+    bool profile = false;        // Saved in profiles made from the current settings
+    unsigned platforms = platform_all;
+
+    constexpr SettingType get_type() const {
+        switch (widget) {
+        case SettingWidget::SwitchRow:
+        case SettingWidget::InvertedSwitchRow:
+            return SettingType::Boolean;
+        case SettingWidget::SpinRow:
+        case SettingWidget::Scale:
+            return SettingType::Integer;
+        default:
+            return SettingType::String;
+        }
+    }
+};
+
+inline constexpr SettingChoice capture_api_choices[] = {{"dxgi", "DXGI"}, {"wgc", "WGC"}};
+// In the same order as IOPriorityClass
+inline constexpr SettingChoice io_priority_class_choices[] = {{"default", "Default"}, {"realtime", "Real-Time"}, {"best-effort", "Best Effort"}, {"idle", "Idle"}};
+
+#ifdef _WIN32
+inline constexpr const char* hwencode_description = "Uses Microsoft Media Foundation for video encoding and conversion";
+#elif defined(__APPLE__)
+inline constexpr const char* hwencode_description = "Uses Apple VideoToolbox for video encoding and conversion";
+#else
+inline constexpr const char* hwencode_description = "Uses VA-API on devices with Intel or AMD GPUs";
+#endif
+
+// Everything in config.toml that Tenebra GTK edits. Rows are built in this order
+// within each group, and a new Tenebra option only needs a line here
+inline constexpr SettingSchema setting_schema[] = {
+    {.key = "password", .widget = SettingWidget::PasswordEntry, .group = SettingGroup::Connection, .title = "Password"},
+    {.key = "port", .widget = SettingWidget::SpinRow, .group = SettingGroup::Connection, .title = "Port", .default_integer = 8080, .min = 0, .max = 65535},
+    {.key = "windows_monitor_index", .widget = SettingWidget::SpinRow, .group = SettingGroup::Capture, .title = "Monitor Index", .description = "The index of the monitor to capture (-1 = primary monitor)", .default_integer = -1, .min = -1, .max = 65535},
+    {.key = "windows_capture_api", .widget = SettingWidget::ComboRow, .group = SettingGroup::Capture, .title = "Screen Capture API", .description = "The API to use for screen capture (DXGI is more compatible, but WGC is newer and more modern)", .default_string = "dxgi", .choices = capture_api_choices},
+    {.key = "startx", .widget = SettingWidget::SpinRow, .group = SettingGroup::Capture, .title = "Start X", .description = "The x-coordinate to start streaming at", .min = 0, .max = 65535},
+    {.key = "starty", .widget = SettingWidget::SpinRow, .group = SettingGroup::Capture, .title = "Start Y", .description = "The y-coordinate to start streaming at", .min = 0, .max = 65535},
+    {.key = "endx", .widget = SettingWidget::SpinRow, .group = SettingGroup::Capture, .title = "End X", .description = "The x-coordinate to stop streaming at", .min = 0, .max = 65535, .optional = true},
+    {.key = "endy", .widget = SettingWidget::SpinRow, .group = SettingGroup::Capture, .title = "End Y", .description = "The y-coordinate to stop streaming at", .min = 0, .max = 65535, .optional = true},
+    {.key = "target_bitrate", .widget = SettingWidget::SpinRow, .group = SettingGroup::Video, .title = "Target Bitrate (kbps)", .default_integer = 4000, .min = 50, .max = 12000, .profile = true},
+    {.key = "vbv_buf_capacity", .widget = SettingWidget::SpinRow, .group = SettingGroup::Video, .title = "VBV Buffer Capacity (ms)", .description = "The size of the video buffering verifier (VBV) buffer, which controls how smoothly bitrate is distributed to prevent playback stuttering or quality drops", .default_integer = 120, .min = 1, .max = 1000, .profile = true},
+    {.key = "hwencode", .widget = SettingWidget::SwitchRow, .group = SettingGroup::Video, .title = "Hardware-Accelerated Video Encoding", .description = hwencode_description, .alias = "vaapi", .profile = true},
+    {.key = "windows_quality_vs_speed", .widget = SettingWidget::Scale, .group = SettingGroup::Video, .title = "Quality vs. Speed", .description = "0 = high speed and low quality, 100 = high quality and low speed", .default_integer = 50, .min = 0, .max = 100, .profile = true},
+    {.key = "vapostproc", .widget = SettingWidget::SwitchRow, .group = SettingGroup::Video, .title = "VA-API Video Conversion", .description = "Enables hardware-accelerated video format conversion on devices with Intel or AMD GPUs", .profile = true},
+    {.key = "full_chroma", .widget = SettingWidget::InvertedSwitchRow, .group = SettingGroup::Video, .title = "Color Channel Downsampling", .description = "Encodes frames in NV12 format", .profile = true},
+#ifdef __APPLE__
+    {.key = "sound_forwarding", .widget = SettingWidget::SwitchRow, .group = SettingGroup::Audio, .title = "Sound Forwarding"},
+#else
+    {.key = "sound_forwarding", .widget = SettingWidget::SwitchRow, .group = SettingGroup::Audio, .title = "Sound Forwarding", .default_boolean = true},
+#endif
+    {.key = "tcp_upnp", .widget = SettingWidget::SwitchRow, .group = SettingGroup::Network, .title = "Automatic ICE-TCP UPnP Forwarding", .description = "Automatically forwards TCP ports for ICE-TCP", .default_boolean = true},
+    {.key = "no_bwe", .widget = SettingWidget::InvertedSwitchRow, .group = SettingGroup::Network, .title = "Bandwidth Estimation", .description = "Adjusts media bitrate on the fly to adapt to changing network conditions", .profile = true},
+    {.key = "shutdown_grace_period", .widget = SettingWidget::SpinRow, .group = SettingGroup::Process, .title = "Shutdown Grace Period (s)", .description = "How long Tenebra is given to exit after being asked to stop before it's killed", .default_integer = 10, .min = 1, .max = 300, .platforms = platform_posix},
+    {.key = "save_log", .widget = SettingWidget::SwitchRow, .group = SettingGroup::Process, .title = "Save Log", .platforms = platform_posix}, // The subtitle names the log's path
+    {.key = "restart_on_crash", .widget = SettingWidget::SwitchRow, .group = SettingGroup::Process, .title = "Restart on Crash", .description = "Relaunches Tenebra if it exits unexpectedly, unless it keeps crashing", .platforms = platform_posix},
+    {.key = "socket_activation", .widget = SettingWidget::SwitchRow, .group = SettingGroup::Process, .title = "Socket Activation", .description = "Keeps the port open while Tenebra restarts, so viewers wait instead of being refused. Tenebra must support LISTEN_FDS", .platforms = platform_linux},
+    {.key = "cpu_affinity", .widget = SettingWidget::Entry, .group = SettingGroup::Scheduling, .title = "CPU Set", .description = "The CPUs Tenebra may run on, like 0-3,6. Leave empty to allow all of them", .platforms = platform_linux},
+    {.key = "nice", .widget = SettingWidget::SpinRow, .group = SettingGroup::Scheduling, .title = "Nice Value", .description = "Lower values get more CPU time. Values below 0 require CAP_SYS_NICE", .min = -20, .max = 19, .platforms = platform_linux},
+    {.key = "io_priority_class", .widget = SettingWidget::ComboRow, .group = SettingGroup::Scheduling, .title = "I/O Priority", .description = "How Tenebra's disk access is scheduled against other processes (Real-Time requires CAP_SYS_ADMIN)", .default_string = "default", .choices = io_priority_class_choices, .platforms = platform_linux},
+    {.key = "rr_priority", .widget = SettingWidget::SpinRow, .group = SettingGroup::Scheduling, .title = "Real-Time Priority", .description = "Runs Tenebra under SCHED_RR at this priority, or normally if 0. Requires CAP_SYS_NICE or an RLIMIT_RTPRIO allowance", .min = 0, .max = 99, .platforms = platform_linux},
+    {.key = "cert", .widget = SettingWidget::Entry, .group = SettingGroup::Security, .title = "TLS Certificate"},
+    {.key = "key", .widget = SettingWidget::Entry, .group = SettingGroup::Security, .title = "Private Key"},
+};
+inline constexpr size_t setting_count = std::size(setting_schema);
+
+// Returns setting_count if there's no such setting
+constexpr size_t get_setting_index(std::string_view key) {
+    for (size_t i = 0; i < setting_count; ++i) {
+        if (setting_schema[i].key == key) return i;
+    }
+    return setting_count;
+}
+
+// For keys written in the source, so that a typo fails to compile and the lookup
+// costs nothing at run time
+consteval size_t setting_index(std::string_view key) {
+    if (size_t ret = get_setting_index(key); ret != setting_count) return ret;
+    throw "Unknown setting";
+}
+
+// std::monostate marks an optional setting that isn't set
+using SettingValue = std::variant<std::monostate, bool, long long, std::string>;
+using Settings = std::array<SettingValue, setting_count>;
+using SettingMask = std::bitset<setting_count>;
+
+Settings get_default_settings();
+// Missing settings take their defaults, and found is set to the ones that weren't
+// missing. Throws std::runtime_error naming the first setting with the wrong type
+Settings parse_settings(const toml::value& config, SettingMask* found = nullptr);
+// Only settings saved on this platform are included
+toml::value serialize_settings(const Settings& settings);
+// The settings that differ between a and b
+SettingMask diff_settings(const Settings& a, const Settings& b);
+
+// A named set of overrides, like a lower bitrate for a constrained uplink
+struct SettingProfile {
+    Settings settings;
+    SettingMask mask; // The settings it overrides
+};
+
+// Parses every .toml file in profiles_path, keyed by file name without the
+// extension. Files that fail to parse or set no known setting, which would match
+// any config, are left out and their names appended to failed
+std::map<std::string, SettingProfile> read_profiles(const std::filesystem::path& profiles_path, std::vector<std::string>& failed);
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <gtk/gtk.h>
+#include <stddef.h>
+
+// GskPath and gtk_snapshot_append_stroke() are new in GTK 4.14, and
+// gtk_widget_get_color() in 4.10
+#if !GTK_CHECK_VERSION(4, 14, 0)
+    #error "Tenebra GTK requires GTK 4.14 or later"
+#endif
+
+// A small line chart of the most recent values. Each push renders a new
+// GtkSnapshot into the picture, which is cheap at the rate samples arrive and
+// avoids subclassing GtkWidget just to draw a line
+class Sparkline {
+protected:
+    GtkWidget* picture = nullptr;
+    std::deque<double> values;
+    size_t capacity = 60;
+    double min_ceiling = 0.; // The chart never zooms in further than this
+
+    static constexpr float width = 96.f;
+    static constexpr float height = 24.f;
+
+    void draw() {
+        if (values.size() < 2) {
+            gtk_picture_set_paintable(GTK_PICTURE(picture), nullptr);
+            return;
+        }
+
+        double ceiling = std::max(*std::max_element(values.begin(), values.end()), min_ceiling);
+        if (ceiling <= 0.) ceiling = 1.;
+
+        // Older values scroll off to the left, so a partly filled chart is right-aligned
+        GskPathBuilder* builder = gsk_path_builder_new();
+        for (size_t i = 0; i < values.size(); ++i) {
+            float x = width * (capacity - values.size() + i) / (capacity - 1);
+            float y = height - 1.f - (height - 2.f) * std::clamp(values[i] / ceiling, 0., 1.);
+            if (i) {
+                gsk_path_builder_line_to(builder, x, y);
+            } else {
+                gsk_path_builder_move_to(builder, x, y);
+            }
+        }
+        GskPath* path = gsk_path_builder_free_to_path(builder);
+        GskStroke* stroke = gsk_stroke_new(1.5f);
+
+        GdkRGBA color;
+        gtk_widget_get_color(picture, &color);
+
+        GtkSnapshot* snapshot = gtk_snapshot_new();
+        gtk_snapshot_append_stroke(snapshot, path, stroke, &color);
+        graphene_size_t size = GRAPHENE_SIZE_INIT(width, height);
+        if (GdkPaintable* paintable = gtk_snapshot_free_to_paintable(snapshot, &size)) {
+            gtk_picture_set_paintable(GTK_PICTURE(picture), paintable);
+            g_object_unref(paintable);
+        }
+
+        gsk_stroke_free(stroke);
+        gsk_path_unref(path);
+    }
+
+public:
+    Sparkline() = default;
+    Sparkline(size_t capacity, double min_ceiling = 0.):
+        picture(gtk_picture_new()),
+        capacity(std::max<size_t>(capacity, 2)),
+        min_ceiling(min_ceiling) {
+        gtk_picture_set_can_shrink(GTK_PICTURE(picture), FALSE);
+        gtk_widget_set_size_request(picture, width, height);
+        gtk_widget_set_valign(picture, GTK_ALIGN_CENTER);
+    }
+
+    // Owned by whichever container it's added to
+    GtkWidget* get() const {
+        return picture;
+    }
+
+    void push(double value) {
+        values.push_back(value);
+        if (values.size() > capacity) values.pop_front();
+        draw();
+    }
+
+    void clear() {
+        values.clear();
+        draw();
+    }
+};
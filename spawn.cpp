@@ -0,0 +1,258 @@
+#include "spawn.hpp"
+#ifndef _WIN32
+    #include <errno.h>
+    #include <signal.h>
+    #include <string.h>
+    #include <unistd.h>
+    #include <vector>
+    #ifdef __linux__
+        #include <fcntl.h>
+        #include <sys/mman.h>
+        #include <sys/resource.h>
+        #include <sys/syscall.h>
+        #include <sys/wait.h>
+    #else
+        #include <spawn.h>
+
+extern char** environ;
+    #endif
+
+// Whether var, a NAME=value string, names one of the variables in env
+static bool is_overridden(const char* var, char* const* env) {
+    size_t name_size = strcspn(var, "=");
+    for (; env && *env; ++env) {
+        if (!strncmp(*env, var, name_size) && (*env)[name_size] == '=') return true;
+    }
+    return false;
+}
+
+    #ifdef __linux__
+struct SpawnArgs {
+    const char* file;
+    char* const* argv;
+    char* const* envp;
+    char* listen_pid; // Where the digits of LISTEN_PID's value go
+    const SpawnOptions* options;
+    sigset_t sigmask; // The parent's, restored once it's safe to take signals
+    int error_fd;
+};
+
+[[noreturn]] static void report_spawn_error(int error_fd) {
+    int error = errno;
+    write(error_fd, &error, sizeof(int));
+    _exit(127);
+}
+
+// Runs on the parent's memory and stack while the parent is suspended, so nothing
+// here may allocate or otherwise touch state the parent owns. Errors go back
+// through a close-on-exec pipe, which reads as EOF once exec succeeds
+static int spawn_child(void* data) {
+    auto args = (SpawnArgs*) data;
+    const SpawnOptions& options = *args->options;
+
+    // The handlers themselves live in the parent's memory, so any that are caught
+    // revert to their defaults before signals are unblocked. Ignored signals stay
+    // ignored, as they would across exec, except for SIGPIPE, which the GUI ignores
+    // for its own sake
+    for (int sig = 1; sig < _NSIG; ++sig) {
+        struct sigaction action;
+        if (!sigaction(sig, nullptr, &action) && action.sa_handler != SIG_DFL && (action.sa_handler != SIG_IGN || sig == SIGPIPE)) {
+            action.sa_handler = SIG_DFL;
+            action.sa_flags = 0;
+            sigemptyset(&action.sa_mask);
+            sigaction(sig, &action, nullptr);
+        }
+    }
+    sigprocmask(SIG_SETMASK, &args->sigmask, nullptr);
+
+    if ((options.stdin_fd != -1 && dup2(options.stdin_fd, STDIN_FILENO) == -1) ||
+        (options.stdout_fd != -1 && dup2(options.stdout_fd, STDOUT_FILENO) == -1) ||
+        (options.stderr_fd != -1 && dup2(options.stderr_fd, STDERR_FILENO) == -1) ||
+        (options.listen_fd != -1 && (options.listen_fd == 3 ? fcntl(3, F_SETFD, 0) : dup2(options.listen_fd, 3)) == -1) ||
+        (options.new_session && setsid() == -1) ||
+        (options.cpu_set && sched_setaffinity(0, sizeof(cpu_set_t), options.cpu_set) == -1)) {
+        report_spawn_error(args->error_fd);
+    }
+
+    if (options.nice_value) setpriority(PRIO_PROCESS, 0, options.nice_value);
+    if (options.io_priority_class != IOPriorityClass::Default) set_io_priority_class(0, options.io_priority_class);
+    if (options.rr_priority) {
+        struct sched_param param = {.sched_priority = options.rr_priority};
+        sched_setscheduler(0, SCHED_RR, &param);
+    }
+
+    if (args->listen_pid) {
+        // Only known now that the child exists. Digits come out least significant first
+        char digits[16];
+        size_t size = 0;
+        for (pid_t pid = syscall(SYS_getpid); pid || !size; pid /= 10) {
+            digits[size++] = '0' + pid % 10;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            args->listen_pid[i] = digits[size - 1 - i];
+        }
+        args->listen_pid[size] = '\0';
+    }
+
+    execvpe(args->file, args->argv, args->envp);
+    report_spawn_error(args->error_fd);
+}
+
+pid_t spawn(const char* file, char* const argv[], const SpawnOptions& options) {
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) == -1) {
+        return -1;
+    }
+
+    // Roomy enough for execvp, which builds each candidate path on the stack
+    const size_t stack_size = 64 * 1024;
+    void* stack;
+    if ((stack = mmap(nullptr, stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0)) == MAP_FAILED) {
+        int error = errno;
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        errno = error;
+        return -1;
+    }
+
+    // CLONE_VM shares memory rather than copying page tables, and CLONE_VFORK
+    // suspends this thread until the child has exec'd or exited. All signals stay
+    // blocked until the child has reset its handlers
+    SpawnArgs args = {file, argv, environ, nullptr, &options, {}, pipe_fds[1]};
+
+    // The environment is built here because the child mustn't allocate. Any LISTEN_*
+    // variables this process inherited describe its own sockets, not the child's
+    std::vector<char*> envp;
+    char listen_fds[] = "LISTEN_FDS=1";
+    char listen_pid[32] = "LISTEN_PID=";
+    if (options.listen_fd != -1 || options.env) {
+        for (char** var = environ; *var; ++var) {
+            if ((options.listen_fd == -1 || strncmp(*var, "LISTEN_", 7)) && !is_overridden(*var, options.env)) {
+                envp.push_back(*var);
+            }
+        }
+        for (char* const* var = options.env; var && *var; ++var) {
+            envp.push_back(*var);
+        }
+        if (options.listen_fd != -1) {
+            envp.push_back(listen_fds);
+            envp.push_back(listen_pid);
+            args.listen_pid = listen_pid + strlen(listen_pid);
+        }
+        envp.push_back(nullptr);
+        args.envp = envp.data();
+    }
+
+    sigset_t all_signals;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &args.sigmask);
+    pid_t pid = clone(spawn_child, (char*) stack + stack_size, CLONE_VM | CLONE_VFORK | SIGCHLD, &args);
+    int error = errno;
+    pthread_sigmask(SIG_SETMASK, &args.sigmask, nullptr);
+    munmap(stack, stack_size);
+    close(pipe_fds[1]);
+
+    if (pid == -1) {
+        close(pipe_fds[0]);
+        errno = error;
+        return -1;
+    }
+
+    if (read(pipe_fds[0], &error, sizeof(int)) == sizeof(int)) {
+        close(pipe_fds[0]);
+        waitpid(pid, nullptr, 0);
+        errno = error;
+        return -1;
+    }
+    close(pipe_fds[0]);
+    return pid;
+}
+    #else
+pid_t spawn(const char* file, char* const argv[], const SpawnOptions& options) {
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    if (options.stdin_fd != -1) posix_spawn_file_actions_adddup2(&file_actions, options.stdin_fd, STDIN_FILENO);
+    if (options.stdout_fd != -1) posix_spawn_file_actions_adddup2(&file_actions, options.stdout_fd, STDOUT_FILENO);
+    if (options.stderr_fd != -1) posix_spawn_file_actions_adddup2(&file_actions, options.stderr_fd, STDERR_FILENO);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    sigset_t sigmask;
+    sigemptyset(&sigmask);
+    posix_spawnattr_setsigmask(&attr, &sigmask);
+    sigset_t default_signals; // See spawn_child()
+    sigemptyset(&default_signals);
+    sigaddset(&default_signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &default_signals);
+        #ifdef POSIX_SPAWN_SETSID
+    if (options.new_session) flags |= POSIX_SPAWN_SETSID;
+        #endif
+    posix_spawnattr_setflags(&attr, flags);
+
+    std::vector<char*> envp;
+    if (options.env) {
+        for (char** var = environ; *var; ++var) {
+            if (!is_overridden(*var, options.env)) envp.push_back(*var);
+        }
+        for (char* const* var = options.env; *var; ++var) {
+            envp.push_back(*var);
+        }
+        envp.push_back(nullptr);
+    }
+
+    // Unlike fork() and exec(), posix_spawn() reports exec failures itself
+    pid_t pid;
+    int error = posix_spawnp(&pid, file, &file_actions, &attr, argv, options.env ? envp.data() : environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&file_actions);
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return pid;
+}
+    #endif
+
+int get_tenebra_spawn_options(const Settings& settings, const std::string& instance, TenebraSpawnOptions& spawn_options) {
+    // Tenebra finds its settings under XDG_CONFIG_HOME, which is also how
+    // get_tenebra_instance() tells instances apart
+    if (!instance.empty()) {
+        spawn_options.config_home = "XDG_CONFIG_HOME=" + get_config_path(instance).parent_path().string();
+        spawn_options.env[0] = spawn_options.config_home.data();
+        spawn_options.options.env = spawn_options.env;
+    }
+
+    #ifdef __linux__
+    const auto& cpu_list = std::get<std::string>(settings[setting_index("cpu_affinity")]);
+    if (!cpu_list.empty()) {
+        if (!parse_cpu_list(cpu_list, spawn_options.cpu_set)) return -1;
+        spawn_options.options.cpu_set = &spawn_options.cpu_set;
+    }
+    spawn_options.options.nice_value = std::get<long long>(settings[setting_index("nice")]);
+    const auto& io_priority_class = std::get<std::string>(settings[setting_index("io_priority_class")]);
+    for (size_t i = 0; i < std::size(io_priority_class_choices); ++i) {
+        if (io_priority_class == io_priority_class_choices[i].value) spawn_options.options.io_priority_class = (IOPriorityClass) i;
+    }
+    spawn_options.options.rr_priority = std::get<long long>(settings[setting_index("rr_priority")]);
+    #endif
+    return 0;
+}
+
+    #ifdef __linux__
+std::vector<const char*> get_refused_spawn_options(pid_t pid, const SpawnOptions& options) {
+    std::vector<const char*> ret;
+    errno = 0;
+    if (int priority = getpriority(PRIO_PROCESS, pid); options.nice_value && !errno && priority != options.nice_value) {
+        ret.push_back("nice value");
+    }
+    if (IOPriorityClass io_priority_class; options.io_priority_class != IOPriorityClass::Default && !get_io_priority_class(pid, io_priority_class) && io_priority_class != options.io_priority_class) {
+        ret.push_back("I/O priority");
+    }
+    if (int policy = sched_getscheduler(pid); options.rr_priority && policy != -1 && policy != SCHED_RR) {
+        ret.push_back("real-time priority");
+    }
+    return ret;
+}
+    #endif
+#endif
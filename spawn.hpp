@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef _WIN32
+    #include "settings.hpp"
+    #include "util.hpp"
+    #include <string>
+    #include <sys/types.h>
+    #ifdef __linux__
+        #include <sched.h>
+        #include <vector>
+    #endif
+
+struct SpawnOptions {
+    // Become the child's stdin, stdout and stderr, or -1 to share the parent's
+    int stdin_fd = -1;
+    int stdout_fd = -1;
+    int stderr_fd = -1;
+    bool new_session = false;
+    // Null-terminated NAME=value strings that are added to the environment, in place
+    // of any inherited variables with the same names
+    char* const* env = nullptr;
+    #ifdef __linux__
+    // Passed as fd 3 following the LISTEN_FDS convention from sd_listen_fds(3)
+    int listen_fd = -1;
+
+    // The CPU set must apply for the spawn to succeed. The rest commonly need
+    // privileges, so they're best-effort
+    const cpu_set_t* cpu_set = nullptr;
+    int nice_value = 0;
+    IOPriorityClass io_priority_class = IOPriorityClass::Default;
+    int rr_priority = 0; // SCHED_RR priority, or 0 to keep the default policy
+    #endif
+};
+
+// Runs a program from PATH without duplicating this process's address space, which
+// fork() does at a cost proportional to the GUI's mappings. Returns the child's
+// PID, or -1 with errno set to why it couldn't be started, including exec failures
+pid_t spawn(const char* file, char* const argv[], const SpawnOptions& options = {});
+
+// SpawnOptions for launching Tenebra, along with what they point to, so it can't
+// be copied. Where Tenebra's stdio goes is left to the caller
+struct TenebraSpawnOptions {
+    SpawnOptions options = {.new_session = true};
+    std::string config_home;
+    char* env[2] = {};
+    #ifdef __linux__
+    cpu_set_t cpu_set;
+    #endif
+
+    TenebraSpawnOptions() = default;
+    TenebraSpawnOptions(const TenebraSpawnOptions&) = delete;
+    TenebraSpawnOptions& operator=(const TenebraSpawnOptions&) = delete;
+};
+
+// Fills in the options an instance's Tenebra is launched with. Returns 0, or -1 if
+// cpu_affinity isn't a valid CPU list
+int get_tenebra_spawn_options(const Settings& settings, const std::string& instance, TenebraSpawnOptions& spawn_options);
+
+    #ifdef __linux__
+// Which of the best-effort options a process was started without, for messages.
+// Call it after spawn() returns, since whatever was refused is final by exec
+std::vector<const char*> get_refused_spawn_options(pid_t pid, const SpawnOptions& options);
+    #endif
+#endif
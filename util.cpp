@@ -1,20 +1,35 @@
 #include "util.hpp"
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
 #include <openssl/pem.h>
 #include <openssl/x509.h>
 #include <stdio.h>
 #ifdef _WIN32
 // clang-format off
     #include <windows.h>
+    #include <io.h>
     #include <tlhelp32.h>
 // clang-format on
 #else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <signal.h>
     #include <stdlib.h>
+    #include <sys/stat.h>
     #include <sys/wait.h>
     #include <unistd.h>
     #ifdef __linux__
-        #include <algorithm>
-        #include <ctype.h>
         #include <fstream>
+        #include <linux/cn_proc.h>
+        #include <linux/connector.h>
+        #include <linux/netlink.h>
+        #include <netinet/in.h>
+        #include <netinet/tcp.h>
+        #include <poll.h>
+        #include <string.h>
+        #include <sys/socket.h>
+        #include <sys/syscall.h>
     #else
         #include <sys/sysctl.h>
         #include <sys/types.h>
@@ -40,67 +55,373 @@ std::filesystem::path get_config_path() {
     return ret;
 }
 
-pid_t get_tenebra_pid() {
+std::filesystem::path get_config_path(const std::string& instance) {
+    std::filesystem::path ret = get_config_path();
+    if (!ret.empty() && !instance.empty()) {
+        ret = ret / "instances" / instance / "tenebra";
+    }
+    return ret;
+}
+
+std::vector<std::string> get_instances() {
+    std::vector<std::string> ret = {{}};
+    std::filesystem::path config_path = get_config_path();
+    if (std::error_code ec; !config_path.empty() && std::filesystem::is_directory(config_path / "instances", ec)) {
+        for (const auto& entry : std::filesystem::directory_iterator(config_path / "instances", ec)) {
+            if (std::string name = entry.path().filename().string(); entry.is_directory(ec) && is_valid_instance_name(name)) {
+                ret.push_back(std::move(name));
+            }
+        }
+        std::sort(ret.begin() + 1, ret.end());
+    }
+    return ret;
+}
+
+// Names become directory names, so anything that could escape instances/ is out
+bool is_valid_instance_name(const std::string& name) {
+    return !name.empty() && name.size() <= 64 && name[0] != '.' && std::all_of(name.begin(), name.end(), [](char c) -> bool {
+        return isalnum((unsigned char) c) || c == '-' || c == '_' || c == '.';
+    });
+}
+
+int write_file_atomically(const std::filesystem::path& path, const std::string& contents) {
 #ifdef _WIN32
-    HANDLE snapshot;
-    if ((snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0)) == INVALID_HANDLE_VALUE) {
+    std::filesystem::path temp_path = path;
+    temp_path += '.' + std::to_string(GetCurrentProcessId()) + ".tmp";
+
+    FILE* fp;
+    if (_wfopen_s(&fp, temp_path.c_str(), L"wb")) {
+        return -1;
+    }
+    if (fwrite(contents.data(), 1, contents.size(), fp) != contents.size() || fflush(fp) || _commit(_fileno(fp))) {
+        fclose(fp);
+        _wremove(temp_path.c_str());
         return -1;
     }
+    fclose(fp);
 
-    PROCESSENTRY32 entry = {.dwSize = sizeof(PROCESSENTRY32)};
-    if (!Process32First(snapshot, &entry)) {
-        CloseHandle(snapshot);
+    if (!MoveFileExW(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        _wremove(temp_path.c_str());
         return -1;
     }
-    do {
-        if (entry.th32ProcessID == GetCurrentProcessId()) {
-            continue;
+#else
+    // mkstemp() creates the file as 0600. An existing file keeps its mode instead
+    std::string temp_path = path.string() + ".XXXXXX";
+    int fd;
+    if ((fd = mkstemp(temp_path.data())) == -1) {
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (struct stat st; !stat(path.c_str(), &st)) {
+        fchmod(fd, st.st_mode & 07777);
+    }
+
+    for (size_t written = 0; written < contents.size();) {
+        ssize_t size;
+        if ((size = write(fd, contents.data() + written, contents.size() - written)) == -1) {
+            if (errno == EINTR) continue;
+            close(fd);
+            unlink(temp_path.c_str());
+            return -1;
         }
+        written += size;
+    }
+    if (fsync(fd) == -1 || close(fd) == -1) {
+        unlink(temp_path.c_str());
+        return -1;
+    }
 
-        if (_strcmpi(entry.szExeFile, "tenebra.exe") == 0) {
-            CloseHandle(snapshot);
-            return entry.th32ProcessID;
+    if (rename(temp_path.c_str(), path.c_str()) == -1) {
+        unlink(temp_path.c_str());
+        return -1;
+    }
+
+    // The rename itself is only durable once the directory is flushed too
+    if (int dir_fd; (dir_fd = open(path.parent_path().empty() ? "." : path.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)) != -1) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+#endif
+    return 0;
+}
+
+#ifdef __linux__
+static std::filesystem::path proc_root = "/proc";
+
+const std::filesystem::path& get_proc_root() {
+    return proc_root;
+}
+
+void set_proc_root(std::filesystem::path proc_root) {
+    ::proc_root = std::move(proc_root);
+}
+
+// Reads the comm and start time (in clock ticks since boot) of a process from
+// /proc/<pid>/stat. The start time is what makes a PID unambiguous, since PIDs
+// are recycled but never within the same tick
+static bool get_process_start_time(pid_t pid, unsigned long long& start_time, std::string& comm) {
+    int fd;
+    if ((fd = open((proc_root / std::to_string(pid) / "stat").c_str(), O_RDONLY | O_CLOEXEC)) == -1) {
+        return false;
+    }
+
+    char buf[1024];
+    ssize_t size = pread(fd, buf, sizeof buf - 1, 0);
+    close(fd);
+    if (size <= 0) return false;
+    buf[size] = '\0';
+
+    // comm is parenthesized and may itself contain spaces or parentheses, so the
+    // remaining fields start after the last ')'
+    char* comm_begin = strchr(buf, '(');
+    char* comm_end = strrchr(buf, ')');
+    if (!comm_begin || !comm_end || comm_end < comm_begin) return false;
+    comm.assign(comm_begin + 1, comm_end);
+
+    // starttime is field 22, and the state after comm is field 3. A zombie has
+    // already exited, and only lingers until its parent reaps it
+    char* field = comm_end + 1;
+    if (field[0] == ' ' && field[1] == 'Z') return false;
+    for (int i = 3; i <= 22; ++i) {
+        while (*field == ' ') ++field;
+        if (!*field) return false;
+        if (i == 22) {
+            start_time = strtoull(field, nullptr, 10);
+            return true;
         }
-    } while (Process32Next(snapshot, &entry));
+        while (*field && *field != ' ') ++field;
+    }
+    return false;
+}
 
-    CloseHandle(snapshot);
+static pid_t get_tenebra_pid_from_pidfile(const std::string& instance) {
+    std::filesystem::path config_path = get_config_path(instance);
+    if (config_path.empty()) return -1;
+
+    std::ifstream pidfile(config_path / "tenebra.pid");
+    pid_t pid;
+    unsigned long long recorded_start_time;
+    if (!(pidfile >> pid >> recorded_start_time) || pid == getpid()) {
+        return -1;
+    }
+
+    unsigned long long start_time;
+    std::string comm;
+    if (get_process_start_time(pid, start_time, comm) && start_time == recorded_start_time && comm == "tenebra") {
+        return pid;
+    }
     return -1;
-#elif defined(__linux__)
-    for (const auto& entry : std::filesystem::directory_iterator("/proc")) {
-        if (entry.is_directory()) {
+}
+
+// Matches a process named tenebra that belongs to the current user. comm is
+// checked first because it's the cheaper read and rules out nearly every process
+static bool is_tenebra_process(const std::filesystem::path& path) {
+    std::ifstream comm_file(path / "comm");
+    std::string comm;
+    if (!comm_file.is_open() || !std::getline(comm_file, comm) || comm != "tenebra") {
+        return false;
+    }
+
+    std::ifstream status_file(path / "status");
+    if (status_file.is_open()) {
+        for (std::string line; std::getline(status_file, line);) {
+            if (!line.rfind("State:\tZ", 0)) {
+                return false;
+            } else if (!line.rfind("Uid:", 0)) {
+                return strtoul(line.c_str() + 5, nullptr, 10) == getuid();
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+bool is_tenebra_pid(pid_t pid) {
+    return pid != getpid() && is_tenebra_process(proc_root / std::to_string(pid));
+}
+
+std::string get_tenebra_instance(pid_t pid) {
+    std::ifstream environ_file(proc_root / std::to_string(pid) / "environ");
+    for (std::string var; std::getline(environ_file, var, '\0');) {
+        if (!var.rfind("XDG_CONFIG_HOME=", 0)) {
+            std::filesystem::path config_home = var.substr(16);
+            if (config_home.parent_path() == get_config_path() / "instances") {
+                return config_home.filename();
+            }
+            break;
+        }
+    }
+    return {};
+}
+
+std::vector<pid_t> get_tenebra_pids(const std::vector<std::string>& instances) {
+    std::vector<pid_t> ret(instances.size());
+    size_t remaining = 0;
+    for (size_t i = 0; i < instances.size(); ++i) {
+        if ((ret[i] = get_tenebra_pid_from_pidfile(instances[i])) == -1) ++remaining;
+    }
+
+    // This runs on a worker thread, where an exception would end the process, so
+    // a procfs that can't be listed (hidepid, an unmounted root, EMFILE) ends the
+    // scan instead
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(proc_root, ec), end; !ec && it != end && remaining; it.increment(ec)) {
+        const auto& entry = *it;
+        if (std::error_code ec; entry.is_directory(ec)) {
             std::filesystem::path path = entry.path();
             std::string filename = path.filename();
             if (std::all_of(filename.begin(), filename.end(), [](char c) -> bool {
                     return isdigit((unsigned char) c);
                 })) {
                 pid_t pid;
-                if ((pid = std::stoi(filename)) == getpid()) {
+                if ((pid = strtol(filename.c_str(), nullptr, 10)) == getpid() || std::find(ret.begin(), ret.end(), pid) != ret.end()) {
                     continue;
                 }
 
-                std::ifstream status_file(path / "status");
-                if (status_file.is_open()) {
-                    bool uid_matches = false;
-                    for (std::string line; std::getline(status_file, line);) {
-                        if (!line.rfind("Uid:", 0)) {
-                            uid_matches = std::stoul(line.substr(5)) == getuid();
+                if (is_tenebra_process(path)) {
+                    std::string instance = get_tenebra_instance(pid);
+                    for (size_t i = 0; i < instances.size(); ++i) {
+                        if (ret[i] == -1 && instances[i] == instance) {
+                            set_tenebra_pidfile(pid, instance); // So the next lookup is a single read
+                            ret[i] = pid;
+                            --remaining;
                             break;
                         }
                     }
-                    if (!uid_matches) continue;
                 }
+            }
+        }
+    }
+    return ret;
+}
 
-                std::ifstream comm_file(path / "comm");
-                if (comm_file.is_open()) {
-                    std::string comm;
-                    if (std::getline(comm_file, comm) && comm == "tenebra") {
-                        return pid;
-                    }
-                }
+int open_proc_events() {
+    int fd;
+    if ((fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR)) == -1) {
+        return -1;
+    }
+
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK, .nl_groups = CN_IDX_PROC};
+    if (bind(fd, (struct sockaddr*) &addr, sizeof addr) == -1) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+
+    alignas(struct nlmsghdr) char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))] = {};
+    auto header = (struct nlmsghdr*) buf;
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+    header->nlmsg_type = NLMSG_DONE;
+    auto message = (struct cn_msg*) NLMSG_DATA(header);
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(enum proc_cn_mcast_op);
+    *(enum proc_cn_mcast_op*) message->data = PROC_CN_MCAST_LISTEN;
+    if (send(fd, buf, header->nlmsg_len, 0) == -1) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+int read_proc_event(int fd, ProcEvent& event) {
+    alignas(struct nlmsghdr) char buf[4096];
+    for (ssize_t size; (size = recv(fd, buf, sizeof buf, 0)) != -1;) {
+        for (auto header = (struct nlmsghdr*) buf; NLMSG_OK(header, (size_t) size); header = NLMSG_NEXT(header, size)) {
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP) continue;
+
+            auto message = (struct cn_msg*) NLMSG_DATA(header);
+            if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) continue;
+
+            auto proc_event = (struct proc_event*) message->data;
+            if (proc_event->what == proc_event::PROC_EVENT_EXEC) {
+                event = {ProcEventType::Exec, proc_event->event_data.exec.process_tgid};
+                return 0;
+            } else if (proc_event->what == proc_event::PROC_EVENT_EXIT &&
+                       proc_event->event_data.exit.process_pid == proc_event->event_data.exit.process_tgid) {
+                // Only the thread group leader's exit means the process is gone
+                event = {ProcEventType::Exit, proc_event->event_data.exit.process_tgid};
+                return 0;
             }
         }
     }
+    return -1;
+}
+#endif
+
+int set_tenebra_pidfile(pid_t pid, const std::string& instance) {
+#ifdef __linux__
+    std::filesystem::path config_path = get_config_path(instance);
+    if (std::error_code ec; config_path.empty() || !std::filesystem::exists(config_path, ec)) return -1;
+
+    unsigned long long start_time;
+    std::string comm;
+    if (get_process_start_time(pid, start_time, comm)) {
+        // A crash partway through a plain rewrite would leave a pidfile that matches
+        // nothing, and the next lookup would fall back to scanning
+        return write_file_atomically(config_path / "tenebra.pid", std::to_string(pid) + ' ' + std::to_string(start_time) + '\n');
+    }
+#endif
+    return -1;
+}
+
+void clear_tenebra_pidfile(pid_t pid, const std::string& instance) {
+#ifdef __linux__
+    if (is_tenebra_pidfile(pid, instance)) {
+        std::error_code ec;
+        std::filesystem::remove(get_config_path(instance) / "tenebra.pid", ec);
+    }
+#endif
+}
+
+bool is_tenebra_pidfile(pid_t pid, const std::string& instance) {
+#ifdef __linux__
+    std::filesystem::path config_path = get_config_path(instance);
+    if (config_path.empty()) return false;
+
+    std::ifstream pidfile(config_path / "tenebra.pid");
+    pid_t recorded_pid;
+    return pidfile >> recorded_pid && recorded_pid == pid;
+#else
+    return false;
+#endif
+}
+
+pid_t get_tenebra_pid(const std::string& instance) {
+#ifdef _WIN32
+    if (!instance.empty()) return -1;
+
+    HANDLE snapshot;
+    if ((snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0)) == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+
+    PROCESSENTRY32 entry = {.dwSize = sizeof(PROCESSENTRY32)};
+    if (!Process32First(snapshot, &entry)) {
+        CloseHandle(snapshot);
+        return -1;
+    }
+    do {
+        if (entry.th32ProcessID == GetCurrentProcessId()) {
+            continue;
+        }
+
+        if (_strcmpi(entry.szExeFile, "tenebra.exe") == 0) {
+            CloseHandle(snapshot);
+            return entry.th32ProcessID;
+        }
+    } while (Process32Next(snapshot, &entry));
+
+    CloseHandle(snapshot);
+    return -1;
+#elif defined(__linux__)
+    return get_tenebra_pids({instance})[0];
 #else
+    if (!instance.empty()) return -1;
+
     size_t size;
     int mib[4] = {CTL_KERN, KERN_PROC, KERN_PROC_UID, (int) getuid()};
     if (sysctl(mib, 4, nullptr, &size, nullptr, 0) == -1) {
@@ -121,6 +442,192 @@ pid_t get_tenebra_pid() {
     return -1;
 }
 
+#ifdef _WIN32
+int start_tenebra_service(std::string& error) {
+    SC_HANDLE sc_manager;
+    if (!(sc_manager = OpenSCManager(nullptr, nullptr, SC_MANAGER_CONNECT))) {
+        error = "OpenSCManager failed, error " + std::to_string(GetLastError());
+        return -1;
+    }
+
+    SC_HANDLE service;
+    if (!(service = OpenService(sc_manager, "Tenebra", SERVICE_START))) {
+        error = "OpenService failed, error " + std::to_string(GetLastError());
+        CloseServiceHandle(sc_manager);
+        return -1;
+    }
+
+    int ret = 0;
+    if (!StartService(service, 0, nullptr)) {
+        error = "StartService failed, error " + std::to_string(GetLastError());
+        ret = -1;
+    }
+    CloseServiceHandle(service);
+    CloseServiceHandle(sc_manager);
+    return ret;
+}
+
+int terminate_tenebra_process(pid_t pid, std::string& error) {
+    HANDLE process;
+    if ((process = OpenProcess(PROCESS_TERMINATE, FALSE, pid)) == nullptr) {
+        error = "OpenProcess failed, error " + std::to_string(GetLastError());
+        return -1;
+    }
+
+    int ret = 0;
+    if (!TerminateProcess(process, 1)) {
+        error = "TerminateProcess failed, error " + std::to_string(GetLastError());
+        ret = -1;
+    }
+    CloseHandle(process);
+    return ret;
+}
+#else
+int terminate_tenebra(pid_t pid, const std::string& instance, int& pidfd) {
+    pidfd = -1;
+    #ifdef __linux__
+    if ((pidfd = open_pidfd(pid)) == -1 && errno == ESRCH) {
+        return 1;
+    }
+    #endif
+    if ((pidfd != -1 ? signal_pidfd(pidfd, SIGTERM) : kill(pid, SIGTERM)) == -1) {
+        int error = errno;
+        if (pidfd != -1) {
+            close(pidfd);
+            pidfd = -1;
+        }
+        if (error == ESRCH) return 1;
+        errno = error;
+        return -1;
+    }
+    clear_tenebra_pidfile(pid, instance);
+    return 0;
+}
+
+int kill_tenebra(pid_t pid, int pidfd) {
+    return pidfd != -1 ? signal_pidfd(pidfd, SIGKILL) : kill(pid, SIGKILL);
+}
+
+bool wait_for_exit(pid_t pid, int pidfd, int timeout) {
+    #ifdef __linux__
+    if (pidfd != -1) {
+        struct pollfd pfd = {.fd = pidfd, .events = POLLIN};
+        return poll(&pfd, 1, timeout) == 1;
+    }
+    #endif
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while (!(kill(pid, 0) == -1 && errno == ESRCH)) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        usleep(10000);
+    }
+    return true;
+}
+#endif
+
+#ifdef __linux__
+int open_pidfd(pid_t pid) {
+    #ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open, pid, 0);
+    #else
+    errno = ENOSYS;
+    return -1;
+    #endif
+}
+
+int signal_pidfd(int pidfd, int sig) {
+    #ifdef SYS_pidfd_send_signal
+    return syscall(SYS_pidfd_send_signal, pidfd, sig, nullptr, 0);
+    #else
+    errno = ENOSYS;
+    return -1;
+    #endif
+}
+
+bool parse_cpu_list(const std::string& str, cpu_set_t& cpu_set) {
+    CPU_ZERO(&cpu_set);
+    for (size_t begin = 0, end; begin <= str.size(); begin = end + 1) {
+        if ((end = str.find(',', begin)) == std::string::npos) end = str.size();
+
+        char* range_end;
+        unsigned long first = strtoul(str.c_str() + begin, &range_end, 10);
+        if (range_end == str.c_str() + begin || !isdigit((unsigned char) str[begin])) return false;
+        unsigned long last = first;
+        if (*range_end == '-') {
+            char* number_begin = range_end + 1;
+            last = strtoul(number_begin, &range_end, 10);
+            if (range_end == number_begin || !isdigit((unsigned char) *number_begin)) return false;
+        }
+        if (range_end != str.c_str() + end || first > last || last >= CPU_SETSIZE) return false;
+
+        for (unsigned long cpu = first; cpu <= last; ++cpu) {
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+    return true;
+}
+
+// From include/uapi/linux/ioprio.h, which older kernel headers lack
+    #define IOPRIO_WHO_PROCESS 1
+    #define IOPRIO_CLASS_SHIFT 13
+
+int set_io_priority_class(pid_t pid, IOPriorityClass io_priority_class) {
+    // Level 4 is the middle of the 0-7 range and what the kernel itself derives
+    // from a nice value of 0
+    return syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, pid, ((int) io_priority_class << IOPRIO_CLASS_SHIFT) | (io_priority_class == IOPriorityClass::Idle ? 0 : 4));
+}
+
+int get_io_priority_class(pid_t pid, IOPriorityClass& io_priority_class) {
+    int io_priority;
+    if ((io_priority = syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, pid)) == -1) {
+        return -1;
+    }
+    io_priority_class = (IOPriorityClass) (io_priority >> IOPRIO_CLASS_SHIFT);
+    return 0;
+}
+
+int open_listen_socket(unsigned short port) {
+    int fd;
+    bool ipv6 = true;
+    if ((fd = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0)) != -1) {
+        int v6_only = 0;
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6_only, sizeof v6_only);
+    } else if (errno == EAFNOSUPPORT && (fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)) != -1) {
+        ipv6 = false;
+    } else {
+        return -1;
+    }
+
+    int reuse_addr = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse_addr, sizeof reuse_addr);
+
+    int result;
+    if (ipv6) {
+        struct sockaddr_in6 addr = {.sin6_family = AF_INET6, .sin6_port = htons(port), .sin6_addr = in6addr_any};
+        result = bind(fd, (struct sockaddr*) &addr, sizeof addr);
+    } else {
+        struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr = {htonl(INADDR_ANY)}};
+        result = bind(fd, (struct sockaddr*) &addr, sizeof addr);
+    }
+    if (result == -1 || listen(fd, SOMAXCONN) == -1) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+int get_accept_queue_length(int fd) {
+    // For listening sockets, the kernel reports the accept queue in tcpi_unacked
+    struct tcp_info info;
+    socklen_t size = sizeof info;
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &size) == -1) {
+        return -1;
+    }
+    return info.tcpi_unacked;
+}
+#endif
+
 std::string get_common_name_from_cert(const char* cert_path) {
     std::string ret = "localhost";
     if (FILE* fp = fopen(cert_path, "r")) {
@@ -2,8 +2,11 @@
 
 #include <filesystem>
 #include <string>
+#include <vector>
 #ifdef _WIN32
     #include <stdint.h>
+#elif defined(__linux__)
+    #include <sched.h>
 #endif
 
 // Bridged
@@ -12,5 +15,103 @@ typedef int64_t pid_t;
 #endif
 
 std::filesystem::path get_config_path();
-pid_t get_tenebra_pid();
+// Named instances keep their settings under instances/<name>/tenebra, and Tenebra
+// is pointed there through XDG_CONFIG_HOME. The default instance's name is empty
+std::filesystem::path get_config_path(const std::string& instance);
+// The default instance first, followed by the named ones in order
+std::vector<std::string> get_instances();
+bool is_valid_instance_name(const std::string& name);
+
+// Writes contents to a temporary file beside path, flushes it to disk and renames
+// it over path, so that a crash leaves either the old file or the new one. Returns
+// 0, or -1 with path untouched
+int write_file_atomically(const std::filesystem::path& path, const std::string& contents);
+
+// Named instances are only told apart on Linux. Elsewhere, any Tenebra process
+// belongs to the default instance
+pid_t get_tenebra_pid(const std::string& instance = {});
+// Records pid as the running Tenebra instance, so that get_tenebra_pid() can
+// validate that one process instead of scanning the whole process table. Returns
+// 0, or -1 if nothing was recorded
+int set_tenebra_pidfile(pid_t pid, const std::string& instance = {});
+// Removes the pidfile if it still names pid, as a sign that pid was asked to exit
+void clear_tenebra_pidfile(pid_t pid, const std::string& instance = {});
+// Whether the pidfile still names pid, whether or not it's running
+bool is_tenebra_pidfile(pid_t pid, const std::string& instance = {});
+
+// Shared by the window and the headless commands, so that both start and stop
+// Tenebra the same way
+#ifdef _WIN32
+// Both return 0, or -1 with error naming the call that failed and its error code
+int start_tenebra_service(std::string& error);
+int terminate_tenebra_process(pid_t pid, std::string& error);
+#else
+// Sends Tenebra SIGTERM and clears its pidfile, so that anything supervising it
+// knows the exit was asked for. On Linux the signal goes through a pidfd, which
+// can't hit a recycled PID, and pidfd is left open for waiting on and escalating
+// through. Otherwise, or without pidfd support, pidfd is set to -1. Returns 0, 1
+// if pid was already gone, or -1 with errno set
+int terminate_tenebra(pid_t pid, const std::string& instance, int& pidfd);
+// Escalates a stop that outlived its grace period
+int kill_tenebra(pid_t pid, int pidfd);
+// Waits up to timeout milliseconds for a process that isn't this one's child,
+// going by its pidfd if it isn't -1. A timeout of 0 just checks
+bool wait_for_exit(pid_t pid, int pidfd, int timeout);
+#endif
+#ifdef __linux__
+// Where procfs is mounted. Overridable so that process discovery can be measured
+// against a synthetic process table of any size. Set it before anything scans
+const std::filesystem::path& get_proc_root();
+void set_proc_root(std::filesystem::path proc_root);
+
+enum class ProcEventType {
+    Exec,
+    Exit,
+};
+
+struct ProcEvent {
+    ProcEventType type;
+    pid_t pid;
+};
+
+bool is_tenebra_pid(pid_t pid);
+// Which instance a Tenebra process belongs to, going by its XDG_CONFIG_HOME
+std::string get_tenebra_instance(pid_t pid);
+// Looks up every instance at once. Each costs a pidfile read, and whichever
+// aren't settled by that share a single scan of the process table
+std::vector<pid_t> get_tenebra_pids(const std::vector<std::string>& instances);
+// Subscribes to process exec/exit events over the netlink proc connector. The
+// kernel only allows this with CAP_NET_ADMIN, so expect -1 with errno set
+int open_proc_events();
+// Reads the next exec or exit of a whole process from a nonblocking socket opened
+// by open_proc_events(), skipping other events. Returns -1 with errno set to
+// EAGAIN once none are left, or ENOBUFS if the kernel had to drop some
+int read_proc_event(int fd, ProcEvent& event);
+
+// Returns a pidfd that polls readable once the process exits, or -1 with errno set.
+// ENOSYS means the kernel predates pidfds (Linux 5.3)
+int open_pidfd(pid_t pid);
+int signal_pidfd(int pidfd, int sig);
+
+// Parses a CPU list in the format taskset and cpusets use, like "0-3,6"
+bool parse_cpu_list(const std::string& str, cpu_set_t& cpu_set);
+
+// Values match the kernel's IOPRIO_CLASS_* constants
+enum class IOPriorityClass {
+    Default = 0, // Derived from the nice value
+    Realtime = 1,
+    BestEffort = 2,
+    Idle = 3,
+};
+
+// Both are plain syscalls, so they're safe to call between fork() and exec()
+int set_io_priority_class(pid_t pid, IOPriorityClass io_priority_class);
+int get_io_priority_class(pid_t pid, IOPriorityClass& io_priority_class);
+
+// Opens a close-on-exec TCP socket listening on port on all addresses, IPv6 and
+// IPv4 alike where possible
+int open_listen_socket(unsigned short port);
+// The number of connections waiting to be accepted on a listening socket
+int get_accept_queue_length(int fd);
+#endif
 std::string get_common_name_from_cert(const char* cert_path);